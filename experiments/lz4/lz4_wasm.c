@@ -6,7 +6,18 @@
 #include <emscripten.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <stdatomic.h>
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <pthread.h>
+#endif
+#define LZ4_STATIC_LINKING_ONLY  // LZ4_attach_dictionary
 #include "repo/lib/lz4.h"
+#include "repo/lib/lz4hc.h"
+#define LZ4F_STATIC_LINKING_ONLY  // LZ4F_ERROR_allocation_failed
+#include "repo/lib/lz4frame.h"
+#include "repo/lib/xxhash.h"
 
 // Version
 EMSCRIPTEN_KEEPALIVE
@@ -62,11 +73,86 @@ int lz4_decompress_partial(const char* src, char* dst, int compressedSize, int t
     return LZ4_decompress_safe_partial(src, dst, compressedSize, targetOutputSize, dstCapacity);
 }
 
+// ---------------------------------------------------------------------------
+// Incompressible-data probe
+//
+// Already-compressed assets (JPEG, WebP, WOFF2) cost full compression time
+// only to be stored raw. Before compressing a block, sample 4 x 1KB spread
+// across it: high order-0 entropy followed by an LZ4 pass over the sample
+// that also fails to shrink it means the block is stored as-is.
+// lz4_compress_alloc, the LZ4F frame encoder (with probing enabled) and the
+// parallel frame compressor all use it.
+// ---------------------------------------------------------------------------
+
+#define LZ4_PROBE_SLICES 4
+#define LZ4_PROBE_SLICE_SIZE 1024
+#define LZ4_PROBE_SAMPLE_SIZE (LZ4_PROBE_SLICES * LZ4_PROBE_SLICE_SIZE)
+#define LZ4_PROBE_MIN_INPUT (4 * LZ4_PROBE_SAMPLE_SIZE)  // smaller blocks: just compress
+#define LZ4_PROBE_ENTROPY_BITS 7.0
+
+// scratch: at least LZ4_PROBE_SAMPLE_SIZE bytes for the match probe output
+static int lz4_probe_block(LZ4_stream_t* state, const char* src, int srcSize, char* scratch) {
+    if (srcSize < LZ4_PROBE_MIN_INPUT || !state) return 0;
+
+    char sample[LZ4_PROBE_SAMPLE_SIZE];
+    int stride = (srcSize - LZ4_PROBE_SLICE_SIZE) / (LZ4_PROBE_SLICES - 1);
+    for (int i = 0; i < LZ4_PROBE_SLICES; i++) {
+        memcpy(sample + i * LZ4_PROBE_SLICE_SIZE, src + i * stride, LZ4_PROBE_SLICE_SIZE);
+    }
+
+    // Order-0 entropy: text/JSON sit around 4-6 bits/byte, compressed media ~8
+    int counts[256] = {0};
+    for (int i = 0; i < LZ4_PROBE_SAMPLE_SIZE; i++) counts[(unsigned char)sample[i]]++;
+    double sumClogC = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i]) sumClogC += counts[i] * log2((double)counts[i]);
+    }
+    double entropy = log2((double)LZ4_PROBE_SAMPLE_SIZE) - sumClogC / LZ4_PROBE_SAMPLE_SIZE;
+    if (entropy < LZ4_PROBE_ENTROPY_BITS) return 0;
+
+    // High entropy can still hide long repeats: confirm with LZ4 itself.
+    // Failing to save ~3% of the sample counts as incompressible.
+    int target = LZ4_PROBE_SAMPLE_SIZE - LZ4_PROBE_SAMPLE_SIZE / 32;
+    return LZ4_compress_fast_extState(state, sample, scratch, LZ4_PROBE_SAMPLE_SIZE, target, 1) == 0;
+}
+
+// LZ4 block holding src as one literal run: what LZ4 emits for data it
+// cannot shrink, minus the match search. Any LZ4 decoder reads it.
+// dst: LZ4_compressBound(srcSize) bytes. Returns: block size
+static int lz4_write_literal_block(const char* src, int srcSize, char* dst) {
+    char* op = dst;
+    if (srcSize < 15) {
+        *op++ = (char)(srcSize << 4);
+    } else {
+        *op++ = (char)0xF0;
+        int rest = srcSize - 15;
+        for (; rest >= 255; rest -= 255) *op++ = (char)255;
+        *op++ = (char)rest;
+    }
+    memcpy(op, src, srcSize);
+    return (int)(op - dst) + srcSize;
+}
+
+// 1 if src looks incompressible (not worth compressing), 0 otherwise
+EMSCRIPTEN_KEEPALIVE
+int lz4_probe_incompressible(const char* src, int srcSize) {
+    LZ4_stream_t* state = LZ4_createStream();
+    char* scratch = (char*)malloc(LZ4_PROBE_SAMPLE_SIZE);
+    int result = scratch ? lz4_probe_block(state, src, srcSize, scratch) : 0;
+    free(scratch);
+    LZ4_freeStream(state);
+    return result;
+}
+
 // High-level compress that allocates output buffer
 // Returns pointer to compressed data (caller must free with lz4_free)
-// Stores compressed size in *outSize
+// Stores compressed size in *outSize. Input the probe finds incompressible
+// (JPEG, WOFF2, ...) skips the match search and comes back as a
+// literals-only block that lz4_decompress reads like any other; *stored
+// (optional) is set to 1 for those, 0 otherwise.
 EMSCRIPTEN_KEEPALIVE
-char* lz4_compress_alloc(const char* src, int srcSize, int* outSize) {
+char* lz4_compress_alloc(const char* src, int srcSize, int* outSize, int* stored) {
+    if (stored) *stored = 0;
     int maxSize = LZ4_compressBound(srcSize);
     char* dst = (char*)malloc(maxSize);
     if (!dst) {
@@ -74,7 +160,17 @@ char* lz4_compress_alloc(const char* src, int srcSize, int* outSize) {
         return NULL;
     }
 
-    int compressedSize = LZ4_compress_default(src, dst, srcSize, maxSize);
+    int compressedSize;
+    LZ4_stream_t* state = srcSize >= LZ4_PROBE_MIN_INPUT ? LZ4_createStream() : NULL;
+    if (lz4_probe_block(state, src, srcSize, dst)) {
+        compressedSize = lz4_write_literal_block(src, srcSize, dst);
+        if (stored) *stored = 1;
+    } else if (state) {
+        compressedSize = LZ4_compress_fast_extState(state, src, dst, srcSize, maxSize, 1);
+    } else {
+        compressedSize = LZ4_compress_default(src, dst, srcSize, maxSize);
+    }
+    LZ4_freeStream(state);
     if (compressedSize <= 0) {
         free(dst);
         *outSize = 0;
@@ -86,7 +182,8 @@ char* lz4_compress_alloc(const char* src, int srcSize, int* outSize) {
 }
 
 // High-level decompress that allocates output buffer
-// originalSize must be known (stored separately when compressing)
+// originalSize must be known (stored separately when compressing);
+// see lz4_sized_* below for a self-describing alternative
 EMSCRIPTEN_KEEPALIVE
 char* lz4_decompress_alloc(const char* src, int compressedSize, int originalSize, int* outSize) {
     char* dst = (char*)malloc(originalSize);
@@ -105,3 +202,1500 @@ char* lz4_decompress_alloc(const char* src, int compressedSize, int originalSize
     *outSize = decompressedSize;
     return dst;
 }
+
+// Little-endian helpers for the container formats below
+static void lz4_write_le32(char* p, uint32_t v) {
+    p[0] = (char)v;
+    p[1] = (char)(v >> 8);
+    p[2] = (char)(v >> 16);
+    p[3] = (char)(v >> 24);
+}
+
+static uint32_t lz4_read_le32(const char* p) {
+    const unsigned char* u = (const unsigned char*)p;
+    return (uint32_t)u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+// ---------------------------------------------------------------------------
+// Self-describing blocks
+//
+// Raw LZ4 blocks don't record their decompressed size, so callers had to
+// store originalSize out of band. Sized blocks carry it in a varint header:
+//   [varint(originalSize << 1 | hasChecksum)][xxh32 of content, optional][LZ4 block]
+// Decoders read the header, allocate exactly once and verify the checksum.
+// ---------------------------------------------------------------------------
+
+#define LZ4_SIZED_MAX_HEADER 9  // 5-byte varint + 4-byte checksum
+// Each byte of an LZ4 block decodes to at most 255 bytes (a match length
+// byte of 255), so a header claiming more than this is lying
+#define LZ4_SIZED_MAX_RATIO 255
+#define LZ4_SIZED_MAX_SLACK 16
+
+static int lz4_write_varint(char* dst, uint64_t v) {
+    int n = 0;
+    while (v >= 0x80) {
+        dst[n++] = (char)(v | 0x80);
+        v >>= 7;
+    }
+    dst[n++] = (char)v;
+    return n;
+}
+
+// Returns: bytes read, or 0 if truncated/overlong
+static int lz4_read_varint(const char* src, int srcSize, uint64_t* v) {
+    *v = 0;
+    for (int n = 0; n < srcSize && n < 5; n++) {
+        unsigned char b = (unsigned char)src[n];
+        *v |= (uint64_t)(b & 0x7F) << (7 * n);
+        if (!(b & 0x80)) return n + 1;
+    }
+    return 0;
+}
+
+// Parse a sized header. Returns: header length, or 0 if invalid (including
+// a size the remaining payload could not possibly decode to, so callers can
+// trust originalSize before allocating it)
+static int lz4_sized_header(const char* src, int srcSize, int* originalSize,
+                            int* hasChecksum, uint32_t* checksum) {
+    uint64_t v;
+    int n = lz4_read_varint(src, srcSize, &v);
+    if (!n || (v >> 1) > 0x7FFFFFFF) return 0;
+
+    *originalSize = (int)(v >> 1);
+    *hasChecksum = (int)(v & 1);
+    if (*hasChecksum) {
+        if (srcSize < n + 4) return 0;
+        *checksum = lz4_read_le32(src + n);
+        n += 4;
+    }
+    if ((uint64_t)*originalSize > (uint64_t)(srcSize - n) * LZ4_SIZED_MAX_RATIO + LZ4_SIZED_MAX_SLACK) {
+        return 0;
+    }
+    return n;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_sized_bound(int srcSize) {
+    return LZ4_SIZED_MAX_HEADER + LZ4_compressBound(srcSize);
+}
+
+// Compress into a sized block
+// Returns: total size (header + block), or 0 if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_sized_compress(const char* src, int srcSize, char* dst, int dstCapacity, int checksum) {
+    if (srcSize < 0 || dstCapacity < LZ4_SIZED_MAX_HEADER) return 0;
+
+    int n = lz4_write_varint(dst, ((uint64_t)srcSize << 1) | (checksum ? 1 : 0));
+    if (checksum) {
+        lz4_write_le32(dst + n, XXH32(src, srcSize, 0));
+        n += 4;
+    }
+
+    int size = LZ4_compress_default(src, dst + n, srcSize, dstCapacity - n);
+    return size > 0 ? n + size : 0;
+}
+
+// Compress into a newly allocated sized block (caller frees with lz4_free)
+EMSCRIPTEN_KEEPALIVE
+char* lz4_sized_compress_alloc(const char* src, int srcSize, int checksum, int* outSize) {
+    int maxSize = lz4_sized_bound(srcSize);
+    char* dst = (char*)malloc(maxSize);
+    if (!dst) {
+        *outSize = 0;
+        return NULL;
+    }
+
+    int size = lz4_sized_compress(src, srcSize, dst, maxSize, checksum);
+    if (size <= 0) {
+        free(dst);
+        *outSize = 0;
+        return NULL;
+    }
+
+    *outSize = size;
+    return dst;
+}
+
+// Decompressed size recorded in the header, or -1 if the header is invalid
+EMSCRIPTEN_KEEPALIVE
+int lz4_sized_content_size(const char* src, int srcSize) {
+    int originalSize, hasChecksum;
+    uint32_t checksum;
+    return lz4_sized_header(src, srcSize, &originalSize, &hasChecksum, &checksum)
+        ? originalSize : -1;
+}
+
+// Decompress into a caller buffer (size it with lz4_sized_content_size)
+// Returns: decompressed size, -1 bad header/data, -2 dst too small,
+//          -3 checksum mismatch
+EMSCRIPTEN_KEEPALIVE
+int lz4_sized_decompress(const char* src, int srcSize, char* dst, int dstCapacity) {
+    int originalSize, hasChecksum;
+    uint32_t checksum = 0;
+    int n = lz4_sized_header(src, srcSize, &originalSize, &hasChecksum, &checksum);
+    if (!n) return -1;
+    if (originalSize > dstCapacity) return -2;
+
+    int size = LZ4_decompress_safe(src + n, dst, srcSize - n, originalSize);
+    if (size != originalSize) return -1;
+    if (hasChecksum && XXH32(dst, size, 0) != checksum) return -3;
+    return size;
+}
+
+// Decompress into an exactly-sized new buffer (caller frees with lz4_free)
+EMSCRIPTEN_KEEPALIVE
+char* lz4_sized_decompress_alloc(const char* src, int srcSize, int* outSize) {
+    int originalSize = lz4_sized_content_size(src, srcSize);
+    char* dst = originalSize >= 0 ? (char*)malloc(originalSize > 0 ? originalSize : 1) : NULL;
+    if (!dst) {
+        *outSize = 0;
+        return NULL;
+    }
+
+    int size = lz4_sized_decompress(src, srcSize, dst, originalSize);
+    if (size < 0) {
+        free(dst);
+        *outSize = 0;
+        return NULL;
+    }
+
+    *outSize = size;
+    return dst;
+}
+
+// ---------------------------------------------------------------------------
+// Context + batch API
+//
+// lz4_compress re-initialises the whole 16KB state per call, and JS pays a
+// boundary crossing plus alloc/free pairs per buffer. A context keeps one
+// LZ4_stream_t (cheap LZ4_resetStream_fast between blocks), and the batch
+// call compresses N inputs described by an offset/length table in one go.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    LZ4_stream_t* stream;
+    int acceleration;
+} lz4_ctx;
+
+EMSCRIPTEN_KEEPALIVE
+lz4_ctx* lz4_ctx_create(int acceleration) {
+    lz4_ctx* ctx = (lz4_ctx*)malloc(sizeof(lz4_ctx));
+    if (!ctx) return NULL;
+
+    ctx->stream = LZ4_createStream();
+    if (!ctx->stream) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->acceleration = acceleration > 0 ? acceleration : 1;
+    return ctx;
+}
+
+// Compress an independent block reusing the context's state
+// Returns: compressed size, or 0 if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_ctx_compress(lz4_ctx* ctx, const char* src, char* dst, int srcSize, int dstCapacity) {
+    LZ4_resetStream_fast(ctx->stream);
+    return LZ4_compress_fast_continue(ctx->stream, src, dst, srcSize, dstCapacity, ctx->acceleration);
+}
+
+// Worst-case output size for a batch (sum of per-item bounds)
+// table: count pairs of [offset, length]
+EMSCRIPTEN_KEEPALIVE
+int lz4_compress_batch_bound(const int* table, int count) {
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        total += LZ4_compressBound(table[i * 2 + 1]);
+    }
+    return total;
+}
+
+// Compress count independent blocks in one call
+// src + table: inputs, table holds count pairs of [offset, length] into src
+// dst: outputs are packed back to back
+// outTable: receives count pairs of [offset, compressedSize] into dst;
+//           compressedSize is -1 for an item that failed (an empty input
+//           still compresses to a 1-byte block, so 0 never appears)
+// Returns: total bytes written to dst, or -(i + 1) where item i is the first
+//          that failed (dst too small or bad input); later items are still
+//          compressed, so only the -1 entries need a retry
+EMSCRIPTEN_KEEPALIVE
+int lz4_compress_batch(lz4_ctx* ctx, const char* src, const int* table, int count,
+                       char* dst, int dstCapacity, int* outTable) {
+    int written = 0;
+    int firstFailed = -1;
+    for (int i = 0; i < count; i++) {
+        int size = lz4_ctx_compress(ctx, src + table[i * 2], dst + written,
+                                    table[i * 2 + 1], dstCapacity - written);
+        outTable[i * 2] = written;
+        if (size <= 0) {
+            outTable[i * 2 + 1] = -1;
+            if (firstFailed < 0) firstFailed = i;
+            continue;
+        }
+        outTable[i * 2 + 1] = size;
+        written += size;
+    }
+    return firstFailed >= 0 ? -(firstFailed + 1) : written;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_ctx_free(lz4_ctx* ctx) {
+    if (!ctx) return;
+    LZ4_freeStream(ctx->stream);
+    free(ctx);
+}
+
+// ---------------------------------------------------------------------------
+// Dictionary API
+//
+// Small payloads (JSON, webhooks) have too little history for LZ4 to find
+// matches. A dictionary of representative samples is hashed once into its
+// own stream; each compress call attaches it to a working stream instead of
+// re-priming the 16KB hash table. The same dictionary bytes are required to
+// decompress.
+// ---------------------------------------------------------------------------
+
+#define LZ4_DICT_MAX_SIZE (64 * 1024)
+
+typedef struct {
+    char* dict;
+    int dictSize;
+    LZ4_stream_t* dictStream;
+    LZ4_stream_t* workStream;
+} lz4_dict;
+
+// Create a dictionary handle; only the last 64KB of the input can be
+// referenced by LZ4, so anything before that is dropped
+// Returns: handle, or NULL on a negative size, NULL data with a non-zero
+// size, or allocation failure
+EMSCRIPTEN_KEEPALIVE
+lz4_dict* lz4_dict_create(const char* dictData, int dictSize) {
+    if (dictSize < 0 || (!dictData && dictSize != 0)) return NULL;
+    if (dictSize > LZ4_DICT_MAX_SIZE) {
+        dictData += dictSize - LZ4_DICT_MAX_SIZE;
+        dictSize = LZ4_DICT_MAX_SIZE;
+    }
+
+    lz4_dict* d = (lz4_dict*)calloc(1, sizeof(lz4_dict));
+    if (!d) return NULL;
+
+    d->dict = (char*)malloc(dictSize > 0 ? dictSize : 1);
+    d->dictStream = LZ4_createStream();
+    d->workStream = LZ4_createStream();
+    if (!d->dict || !d->dictStream || !d->workStream) {
+        free(d->dict);
+        LZ4_freeStream(d->dictStream);
+        LZ4_freeStream(d->workStream);
+        free(d);
+        return NULL;
+    }
+
+    if (dictSize > 0) memcpy(d->dict, dictData, dictSize);
+    d->dictSize = LZ4_loadDict(d->dictStream, d->dict, dictSize);
+    return d;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_dict_size(lz4_dict* d) {
+    return d->dictSize;
+}
+
+// Compress an independent message against the dictionary
+// Returns: compressed size, or 0 if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_dict_compress(lz4_dict* d, const char* src, char* dst, int srcSize,
+                      int dstCapacity, int acceleration) {
+    LZ4_resetStream_fast(d->workStream);
+    LZ4_attach_dictionary(d->workStream, d->dictStream);
+    return LZ4_compress_fast_continue(d->workStream, src, dst, srcSize, dstCapacity, acceleration);
+}
+
+// Returns: decompressed size, or negative value if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_dict_decompress(lz4_dict* d, const char* src, char* dst, int compressedSize, int dstCapacity) {
+    return LZ4_decompress_safe_usingDict(src, dst, compressedSize, dstCapacity, d->dict, d->dictSize);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_dict_free(lz4_dict* d) {
+    if (!d) return;
+    LZ4_freeStream(d->dictStream);
+    LZ4_freeStream(d->workStream);
+    free(d->dict);
+    free(d);
+}
+
+// ---------------------------------------------------------------------------
+// HC (high compression) API
+//
+// Slower compression (levels 3-12) for data compressed once and decoded many
+// times; output is plain LZ4 so lz4_decompress is unchanged and just as fast.
+// ---------------------------------------------------------------------------
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_hc_level_min() {
+    return LZ4HC_CLEVEL_MIN;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_hc_level_default() {
+    return LZ4HC_CLEVEL_DEFAULT;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_hc_level_max() {
+    return LZ4HC_CLEVEL_MAX;
+}
+
+// One-shot HC compress (allocates its ~256KB state internally on every call)
+// Returns: compressed size, or 0 if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_compress_hc(const char* src, char* dst, int srcSize, int dstCapacity, int level) {
+    return LZ4_compress_HC(src, dst, srcSize, dstCapacity, level);
+}
+
+// Reusable HC context: holds the state and a per-job level so batches of
+// files skip the state allocation and can each pick their own trade-off
+typedef struct {
+    LZ4_streamHC_t* stream;
+    int level;
+} lz4_hc_ctx;
+
+EMSCRIPTEN_KEEPALIVE
+lz4_hc_ctx* lz4_hc_create(int level) {
+    lz4_hc_ctx* ctx = (lz4_hc_ctx*)malloc(sizeof(lz4_hc_ctx));
+    if (!ctx) return NULL;
+
+    ctx->stream = LZ4_createStreamHC();
+    if (!ctx->stream) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->level = level;
+    return ctx;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_hc_set_level(lz4_hc_ctx* ctx, int level) {
+    ctx->level = level;
+}
+
+// Compress an independent block with the context's level
+// Returns: compressed size, or 0 if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_hc_compress(lz4_hc_ctx* ctx, const char* src, char* dst, int srcSize, int dstCapacity) {
+    LZ4_resetStreamHC_fast(ctx->stream, ctx->level);
+    return LZ4_compress_HC_continue(ctx->stream, src, dst, srcSize, dstCapacity);
+}
+
+// Fill at most targetDstSize bytes of output (e.g. a fixed-size page/packet)
+// *srcSizePtr: in = input available, out = input actually consumed
+// Returns: compressed size, or 0 if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_hc_compress_dest_size(lz4_hc_ctx* ctx, const char* src, char* dst,
+                              int* srcSizePtr, int targetDstSize) {
+    LZ4_resetStreamHC_fast(ctx->stream, ctx->level);
+    return LZ4_compress_HC_continue_destSize(ctx->stream, src, dst, srcSizePtr, targetDstSize);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_hc_free(lz4_hc_ctx* ctx) {
+    if (!ctx) return;
+    LZ4_freeStreamHC(ctx->stream);
+    free(ctx);
+}
+
+// ---------------------------------------------------------------------------
+// Frame (LZ4F) streaming API
+//
+// Produces/consumes standard .lz4 frames (interoperable with the lz4 CLI) in
+// chunks, so the full input never has to be resident in the WASM heap.
+// Each handle owns a reusable output buffer: after every call JS copies
+// `lz4_frame_*_output_size()` bytes out of `lz4_frame_*_output()` before
+// the next call. Functions return bytes produced, or a negative LZ4F error
+// code (see lz4_frame_error_name). When the wrapper cannot grow its output
+// buffer it returns LZ4_FRAME_ERROR_ALLOC, LZ4F's own out-of-memory code, so
+// JS sees "ERROR_allocation_failed" rather than ERROR_GENERIC.
+// ---------------------------------------------------------------------------
+
+#define LZ4_FRAME_ERROR_ALLOC (-(int)LZ4F_ERROR_allocation_failed)
+
+typedef struct {
+    LZ4F_cctx* cctx;
+    LZ4F_preferences_t prefs;
+    char* out;
+    size_t outCapacity;
+    size_t outSize;
+    // Incompressible-block bypass (NULL probeState: disabled)
+    LZ4_stream_t* probeState;
+    char* probeScratch;
+    char* stage;      // partial block held back until it can be probed
+    size_t stageSize;
+    size_t blockSize;
+    int bypassed;     // blocks stored raw in the current frame
+} lz4_frame_encoder;
+
+typedef struct {
+    LZ4F_dctx* dctx;
+    char* out;
+    size_t outCapacity;
+    size_t outSize;
+    int finished;
+} lz4_frame_decoder;
+
+// Grow a handle-owned output buffer; capacity is kept across calls
+static int lz4_frame_reserve(char** buf, size_t* capacity, size_t needed) {
+    if (needed <= *capacity) return 1;
+    size_t newCapacity = *capacity * 2 > needed ? *capacity * 2 : needed;
+    char* grown = (char*)realloc(*buf, newCapacity);
+    if (!grown) return 0;
+    *buf = grown;
+    *capacity = newCapacity;
+    return 1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char* lz4_frame_error_name(int code) {
+    return LZ4F_getErrorName((LZ4F_errorCode_t)code);
+}
+
+// Create a frame encoder
+// blockSizeId: 4 = 64KB, 5 = 256KB, 6 = 1MB, 7 = 4MB (0 = default 64KB)
+// blockChecksum/contentChecksum: 0 or 1
+// compressionLevel: 0 = fast (LZ4_compress_default), 3-12 = HC
+// probe (optional, 0 if omitted): run the incompressible-data probe on each
+// block and store the ones it flags uncompressed. LZ4F only mixes stored and
+// compressed blocks in independent-block frames, so this also switches the
+// frame from linked to independent blocks (slightly lower ratio on text).
+EMSCRIPTEN_KEEPALIVE
+lz4_frame_encoder* lz4_frame_encoder_create(int blockSizeId, int blockChecksum,
+                                            int contentChecksum, int compressionLevel,
+                                            int probe) {
+    lz4_frame_encoder* enc = (lz4_frame_encoder*)calloc(1, sizeof(lz4_frame_encoder));
+    if (!enc) return NULL;
+
+    if (LZ4F_isError(LZ4F_createCompressionContext(&enc->cctx, LZ4F_VERSION))) {
+        free(enc);
+        return NULL;
+    }
+
+    if (probe) {
+        enc->blockSize = LZ4F_getBlockSize((LZ4F_blockSizeID_t)blockSizeId);
+        enc->probeState = LZ4_createStream();
+        enc->probeScratch = (char*)malloc(LZ4_PROBE_SAMPLE_SIZE);
+        enc->stage = (char*)malloc(enc->blockSize);
+        if (!enc->probeState || !enc->probeScratch || !enc->stage) {
+            LZ4_freeStream(enc->probeState);
+            free(enc->probeScratch);
+            free(enc->stage);
+            LZ4F_freeCompressionContext(enc->cctx);
+            free(enc);
+            return NULL;
+        }
+    }
+
+    enc->prefs.frameInfo.blockSizeID = (LZ4F_blockSizeID_t)blockSizeId;
+    enc->prefs.frameInfo.blockMode = probe ? LZ4F_blockIndependent : LZ4F_blockLinked;
+    enc->prefs.frameInfo.blockChecksumFlag = blockChecksum ? LZ4F_blockChecksumEnabled : LZ4F_noBlockChecksum;
+    enc->prefs.frameInfo.contentChecksumFlag = contentChecksum ? LZ4F_contentChecksumEnabled : LZ4F_noContentChecksum;
+    enc->prefs.compressionLevel = compressionLevel;
+    return enc;
+}
+
+// Start a new frame (writes the frame header). Handles can be reused for
+// several frames by calling begin again after end.
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_encoder_begin(lz4_frame_encoder* enc) {
+    enc->outSize = 0;
+    enc->stageSize = 0;
+    enc->bypassed = 0;
+    if (!lz4_frame_reserve(&enc->out, &enc->outCapacity, LZ4F_HEADER_SIZE_MAX)) return LZ4_FRAME_ERROR_ALLOC;
+
+    size_t written = LZ4F_compressBegin(enc->cctx, enc->out, enc->outCapacity, &enc->prefs);
+    if (LZ4F_isError(written)) return (int)written;
+    enc->outSize = written;
+    return (int)written;
+}
+
+// Probing mode hands LZ4F one whole block at a time (the last one may be
+// short), so LZ4F never buffers input and a switch between stored and
+// compressed blocks never has to flush a partial block. Appends to enc->out.
+static int lz4_frame_encoder_put_block(lz4_frame_encoder* enc, const char* block, size_t size) {
+    size_t bound = enc->outSize + LZ4F_compressBound(size, &enc->prefs);
+    if (!lz4_frame_reserve(&enc->out, &enc->outCapacity, bound)) return LZ4_FRAME_ERROR_ALLOC;
+
+    char* dst = enc->out + enc->outSize;
+    size_t dstCapacity = enc->outCapacity - enc->outSize;
+    size_t written;
+    if (lz4_probe_block(enc->probeState, block, (int)size, enc->probeScratch)) {
+        written = LZ4F_uncompressedUpdate(enc->cctx, dst, dstCapacity, block, size, NULL);
+        enc->bypassed++;
+    } else {
+        written = LZ4F_compressUpdate(enc->cctx, dst, dstCapacity, block, size, NULL);
+    }
+    if (LZ4F_isError(written)) return (int)written;
+    enc->outSize += written;
+    return 0;
+}
+
+// Whole blocks go straight from src; anything shorter waits in enc->stage
+static int lz4_frame_encoder_update_probed(lz4_frame_encoder* enc, const char* src, size_t srcSize) {
+    while (srcSize > 0) {
+        const char* block = NULL;
+        size_t taken;
+        if (enc->stageSize == 0 && srcSize >= enc->blockSize) {
+            block = src;
+            taken = enc->blockSize;
+        } else {
+            size_t room = enc->blockSize - enc->stageSize;
+            taken = srcSize < room ? srcSize : room;
+            memcpy(enc->stage + enc->stageSize, src, taken);
+            enc->stageSize += taken;
+            if (enc->stageSize == enc->blockSize) {
+                block = enc->stage;
+                enc->stageSize = 0;
+            }
+        }
+        if (block) {
+            int result = lz4_frame_encoder_put_block(enc, block, enc->blockSize);
+            if (result < 0) return result;
+        }
+        src += taken;
+        srcSize -= taken;
+    }
+    return (int)enc->outSize;
+}
+
+// Feed a chunk of input; emits zero or more complete blocks
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_encoder_update(lz4_frame_encoder* enc, const char* src, int srcSize) {
+    enc->outSize = 0;
+    if (enc->probeState) return lz4_frame_encoder_update_probed(enc, src, (size_t)srcSize);
+
+    size_t bound = LZ4F_compressBound((size_t)srcSize, &enc->prefs);
+    if (!lz4_frame_reserve(&enc->out, &enc->outCapacity, bound)) return LZ4_FRAME_ERROR_ALLOC;
+
+    size_t written = LZ4F_compressUpdate(enc->cctx, enc->out, enc->outCapacity,
+                                         src, (size_t)srcSize, NULL);
+    if (LZ4F_isError(written)) return (int)written;
+    enc->outSize = written;
+    return (int)written;
+}
+
+// Flush buffered input and write the end mark (+ content checksum)
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_encoder_end(lz4_frame_encoder* enc) {
+    enc->outSize = 0;
+    if (enc->stageSize > 0) {
+        int result = lz4_frame_encoder_put_block(enc, enc->stage, enc->stageSize);
+        if (result < 0) return result;
+        enc->stageSize = 0;
+    }
+    size_t bound = enc->outSize + LZ4F_compressBound(0, &enc->prefs);
+    if (!lz4_frame_reserve(&enc->out, &enc->outCapacity, bound)) return LZ4_FRAME_ERROR_ALLOC;
+
+    size_t written = LZ4F_compressEnd(enc->cctx, enc->out + enc->outSize,
+                                      enc->outCapacity - enc->outSize, NULL);
+    if (LZ4F_isError(written)) return (int)written;
+    enc->outSize += written;
+    return (int)enc->outSize;
+}
+
+EMSCRIPTEN_KEEPALIVE
+char* lz4_frame_encoder_output(lz4_frame_encoder* enc) {
+    return enc->out;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_encoder_output_size(lz4_frame_encoder* enc) {
+    return (int)enc->outSize;
+}
+
+// Blocks stored uncompressed in the current frame (0 unless created with probe)
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_encoder_bypassed(lz4_frame_encoder* enc) {
+    return enc->bypassed;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_frame_encoder_free(lz4_frame_encoder* enc) {
+    if (!enc) return;
+    LZ4F_freeCompressionContext(enc->cctx);
+    LZ4_freeStream(enc->probeState);
+    free(enc->probeScratch);
+    free(enc->stage);
+    free(enc->out);
+    free(enc);
+}
+
+EMSCRIPTEN_KEEPALIVE
+lz4_frame_decoder* lz4_frame_decoder_create(void) {
+    lz4_frame_decoder* dec = (lz4_frame_decoder*)calloc(1, sizeof(lz4_frame_decoder));
+    if (!dec) return NULL;
+
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&dec->dctx, LZ4F_VERSION))) {
+        free(dec);
+        return NULL;
+    }
+    return dec;
+}
+
+// Feed a chunk of compressed input (any size, may split blocks/headers).
+// All of it is consumed; decoded bytes land in the output buffer.
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_decoder_update(lz4_frame_decoder* dec, const char* src, int srcSize) {
+    const char* srcEnd = src + srcSize;
+    dec->outSize = 0;
+    if (srcSize == 0 && dec->finished) return 0;
+
+    for (;;) {
+        // Make room for at least one 64KB block per iteration
+        if (!lz4_frame_reserve(&dec->out, &dec->outCapacity, dec->outSize + 65536)) return LZ4_FRAME_ERROR_ALLOC;
+
+        size_t srcConsumed = (size_t)(srcEnd - src);
+        size_t dstWritten = dec->outCapacity - dec->outSize;
+        size_t hint = LZ4F_decompress(dec->dctx, dec->out + dec->outSize, &dstWritten,
+                                      src, &srcConsumed, NULL);
+        if (LZ4F_isError(hint)) return (int)hint;
+
+        src += srcConsumed;
+        dec->outSize += dstWritten;
+        dec->finished = (hint == 0);
+
+        // Input exhausted and either the frame is complete or nothing is left
+        // to flush. Leftover input after an end mark starts the next frame.
+        if (src >= srcEnd && (dec->finished || dstWritten == 0)) break;
+    }
+    return (int)dec->outSize;
+}
+
+// 1 once the end mark (and content checksum, if any) has been verified
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_decoder_finished(lz4_frame_decoder* dec) {
+    return dec->finished;
+}
+
+// Reset to decode a new frame, keeping the output buffer
+EMSCRIPTEN_KEEPALIVE
+void lz4_frame_decoder_reset(lz4_frame_decoder* dec) {
+    LZ4F_resetDecompressionContext(dec->dctx);
+    dec->outSize = 0;
+    dec->finished = 0;
+}
+
+EMSCRIPTEN_KEEPALIVE
+char* lz4_frame_decoder_output(lz4_frame_decoder* dec) {
+    return dec->out;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_decoder_output_size(lz4_frame_decoder* dec) {
+    return (int)dec->outSize;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_frame_decoder_free(lz4_frame_decoder* dec) {
+    if (!dec) return;
+    LZ4F_freeDecompressionContext(dec->dctx);
+    free(dec->out);
+    free(dec);
+}
+
+// ---------------------------------------------------------------------------
+// Block-parallel frame compression
+//
+// Splits the input into independent blocks and compresses them on a pthread
+// pool (build with -pthread, see LEARNINGS.md), then writes one standard LZ4
+// frame with the blocks in order. Without -pthread the same entry point runs
+// serially, so JS can call it unconditionally.
+//
+// Workers compress block i straight into its worst-case slot in dst; the
+// main thread computes the content checksum meanwhile, then compacts the
+// slots in order and fills in block headers. No scratch copy of the input.
+// ---------------------------------------------------------------------------
+
+#define LZ4_PARALLEL_MAX_THREADS 64
+#define LZ4_FRAME_MAGIC 0x184D2204U
+#define LZ4_FRAME_HEADER_SIZE 15  // magic + FLG + BD + content size + HC
+
+typedef struct {
+    const char* src;
+    int srcSize;
+    int blockSize;
+    int nBlocks;
+    char* slots;          // block i payload goes to slots + i * slotStride
+    int slotStride;
+    int* storedSizes;     // block header value (high bit = stored raw)
+    uint32_t* checksums;
+    int blockChecksum;
+    atomic_int next;
+    atomic_int bypassed;  // blocks stored raw after a failed probe
+} lz4_parallel_job;
+
+static int lz4_block_size_from_id(int blockSizeId) {
+    if (blockSizeId == 0) blockSizeId = 4;
+    if (blockSizeId < 4 || blockSizeId > 7) return 0;
+    return 65536 << (2 * (blockSizeId - 4));
+}
+
+static void* lz4_parallel_worker(void* arg) {
+    lz4_parallel_job* job = (lz4_parallel_job*)arg;
+    LZ4_stream_t* state = LZ4_createStream();
+
+    for (;;) {
+        int i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->nBlocks) break;
+
+        const char* in = job->src + (size_t)i * job->blockSize;
+        int inSize = job->srcSize - i * job->blockSize;
+        if (inSize > job->blockSize) inSize = job->blockSize;
+        char* out = job->slots + (size_t)i * job->slotStride;
+
+        // Capacity inSize - 1: anything that doesn't shrink is stored raw
+        int size = 0;
+        if (lz4_probe_block(state, in, inSize, out)) {
+            atomic_fetch_add(&job->bypassed, 1);
+        } else if (state) {
+            size = LZ4_compress_fast_extState(state, in, out, inSize, inSize - 1, 1);
+        }
+        if (size <= 0) {
+            memcpy(out, in, inSize);
+            job->storedSizes[i] = (int)(0x80000000U | (uint32_t)inSize);
+            size = inSize;
+        } else {
+            job->storedSizes[i] = size;
+        }
+        if (job->blockChecksum) job->checksums[i] = XXH32(out, size, 0);
+    }
+
+    LZ4_freeStream(state);
+    return NULL;
+}
+
+// Frame header for independent blocks with the content size recorded
+// (LZ4_FRAME_HEADER_SIZE bytes)
+static void lz4_write_frame_header(char* dst, int srcSize, int blockSizeId,
+                                   int blockChecksum, int contentChecksum) {
+    unsigned char flg = 0x40 | 0x20 | 0x08;  // version 01, independent blocks, content size
+    if (blockChecksum) flg |= 0x10;
+    if (contentChecksum) flg |= 0x04;
+    lz4_write_le32(dst, LZ4_FRAME_MAGIC);
+    dst[4] = (char)flg;
+    dst[5] = (char)(blockSizeId << 4);
+    lz4_write_le32(dst + 6, (uint32_t)srcSize);
+    lz4_write_le32(dst + 10, 0);
+    dst[14] = (char)((XXH32(dst + 4, 10, 0) >> 8) & 0xFF);
+}
+
+// Worst-case dst size for lz4_frame_compress_parallel
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_parallel_bound(int srcSize, int blockSizeId) {
+    int blockSize = lz4_block_size_from_id(blockSizeId);
+    if (!blockSize) return 0;
+    int nBlocks = (srcSize + blockSize - 1) / blockSize;
+    return LZ4_FRAME_HEADER_SIZE + nBlocks * (blockSize + 8) + 8;
+}
+
+// Compress src into a single LZ4 frame (independent blocks, content size
+// recorded in the header) using up to `threads` threads
+// blockSizeId: 4 = 64KB, 5 = 256KB, 6 = 1MB, 7 = 4MB (0 = 64KB)
+// bypassedBlocks: optional, receives the number of blocks the probe stored
+//                 raw without attempting compression
+// Returns: frame size, or negative value if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_frame_compress_parallel(const char* src, int srcSize, char* dst, int dstCapacity,
+                                int blockSizeId, int blockChecksum, int contentChecksum,
+                                int threads, int* bypassedBlocks) {
+    int blockSize = lz4_block_size_from_id(blockSizeId);
+    if (!blockSize || srcSize < 0) return -1;
+    if (dstCapacity < lz4_frame_parallel_bound(srcSize, blockSizeId)) return -2;
+    if (blockSizeId == 0) blockSizeId = 4;
+
+    lz4_parallel_job job;
+    job.src = src;
+    job.srcSize = srcSize;
+    job.blockSize = blockSize;
+    job.nBlocks = (srcSize + blockSize - 1) / blockSize;
+    job.slotStride = blockSize + 8;
+    job.slots = dst + LZ4_FRAME_HEADER_SIZE + 4;
+    job.blockChecksum = blockChecksum;
+    atomic_init(&job.next, 0);
+    atomic_init(&job.bypassed, 0);
+    job.storedSizes = (int*)malloc(sizeof(int) * (job.nBlocks + 1));
+    job.checksums = (uint32_t*)malloc(sizeof(uint32_t) * (job.nBlocks + 1));
+    if (!job.storedSizes || !job.checksums) {
+        free(job.storedSizes);
+        free(job.checksums);
+        return -3;
+    }
+
+    if (threads < 1) threads = 1;
+    if (threads > LZ4_PARALLEL_MAX_THREADS) threads = LZ4_PARALLEL_MAX_THREADS;
+    if (threads > job.nBlocks) threads = job.nBlocks > 0 ? job.nBlocks : 1;
+
+    uint32_t contentHash = 0;
+#ifdef __EMSCRIPTEN_PTHREADS__
+    pthread_t workers[LZ4_PARALLEL_MAX_THREADS];
+    int started = 0;
+    while (started < threads &&
+           pthread_create(&workers[started], NULL, lz4_parallel_worker, &job) == 0) {
+        started++;
+    }
+    // Hash the input while the workers compress it
+    if (contentChecksum) contentHash = XXH32(src, srcSize, 0);
+    // No thread could be started: compress everything on this thread
+    if (started == 0) lz4_parallel_worker(&job);
+    for (int t = 0; t < started; t++) pthread_join(workers[t], NULL);
+#else
+    (void)threads;
+    lz4_parallel_worker(&job);
+    if (contentChecksum) contentHash = XXH32(src, srcSize, 0);
+#endif
+
+    lz4_write_frame_header(dst, srcSize, blockSizeId, blockChecksum, contentChecksum);
+
+    // Compact slots in order; each block's final position never passes its
+    // slot, so a forward memmove is safe
+    size_t pos = LZ4_FRAME_HEADER_SIZE;
+    for (int i = 0; i < job.nBlocks; i++) {
+        int size = job.storedSizes[i] & 0x7FFFFFFF;
+        memmove(dst + pos + 4, job.slots + (size_t)i * job.slotStride, size);
+        lz4_write_le32(dst + pos, (uint32_t)job.storedSizes[i]);
+        pos += 4 + size;
+        if (blockChecksum) {
+            lz4_write_le32(dst + pos, job.checksums[i]);
+            pos += 4;
+        }
+    }
+
+    lz4_write_le32(dst + pos, 0);  // end mark
+    pos += 4;
+    if (contentChecksum) {
+        lz4_write_le32(dst + pos, contentHash);
+        pos += 4;
+    }
+
+    if (bypassedBlocks) *bypassedBlocks = atomic_load(&job.bypassed);
+    free(job.storedSizes);
+    free(job.checksums);
+    return (int)pos;
+}
+
+// ---------------------------------------------------------------------------
+// Adaptive acceleration
+//
+// The right acceleration depends on how compressible the input is, which
+// the caller can't know up front. The adaptive encoder takes a throughput
+// target (MB/s) and/or a per-call latency budget and moves acceleration up or
+// down so the rest of the call meets the target. Throughput is measured over
+// a window of blocks that must span LZ4_ADAPTIVE_WINDOW_MS: with coarse or
+// clamped timers a single 64KB block often measures 0ms. The window and the
+// acceleration carry over between calls, so small calls still adapt and
+// steady traffic starts warm.
+// Output is a standard LZ4 frame (independent blocks, content size).
+// ---------------------------------------------------------------------------
+
+#define LZ4_ADAPTIVE_BLOCK_ID 4  // 64KB blocks: fine-grained enough to react
+#define LZ4_ADAPTIVE_MAX_ACCELERATION 1024
+#define LZ4_ADAPTIVE_WINDOW_MS 4.0  // several ticks of a 1ms-clamped timer
+
+typedef struct {
+    LZ4_stream_t* state;
+    double targetMBps;   // 0 = none
+    double budgetMs;     // per call, 0 = none
+    int acceleration;
+    double lastMBps;     // throughput of the last call
+    double windowBytes;  // measured since the last adjustment
+    double windowMs;
+    char* out;
+    size_t outSize;
+    size_t outCapacity;
+} lz4_adaptive;
+
+// Create an adaptive encoder; set targetMBps, budgetMs or both (the stricter
+// one wins for every block)
+EMSCRIPTEN_KEEPALIVE
+lz4_adaptive* lz4_adaptive_create(double targetMBps, double budgetMs) {
+    lz4_adaptive* h = (lz4_adaptive*)calloc(1, sizeof(lz4_adaptive));
+    if (!h) return NULL;
+
+    h->state = LZ4_createStream();
+    if (!h->state) {
+        free(h);
+        return NULL;
+    }
+    h->targetMBps = targetMBps > 0 ? targetMBps : 0;
+    h->budgetMs = budgetMs > 0 ? budgetMs : 0;
+    h->acceleration = 1;
+    return h;
+}
+
+// Compress src into one frame in the handle's output buffer
+// Returns: frame size, or negative value if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_adaptive_compress(lz4_adaptive* h, const char* src, int srcSize) {
+    if (srcSize < 0) return -1;
+    int blockSize = lz4_block_size_from_id(LZ4_ADAPTIVE_BLOCK_ID);
+    int bound = lz4_frame_parallel_bound(srcSize, LZ4_ADAPTIVE_BLOCK_ID);
+    if (!lz4_frame_reserve(&h->out, &h->outCapacity, (size_t)bound)) return -3;
+
+    char* dst = h->out;
+    lz4_write_frame_header(dst, srcSize, LZ4_ADAPTIVE_BLOCK_ID, 0, 0);
+    size_t pos = LZ4_FRAME_HEADER_SIZE;
+
+    double start = emscripten_get_now();
+    for (int done = 0; done < srcSize; ) {
+        int inSize = srcSize - done < blockSize ? srcSize - done : blockSize;
+
+        // Required rate for this block: the fixed target, or whatever the
+        // remaining budget needs for the remaining bytes, whichever is higher
+        double now = emscripten_get_now();
+        double required = h->targetMBps;
+        if (h->budgetMs > 0) {
+            double leftMs = h->budgetMs - (now - start);
+            double needed = leftMs > 0 ? (srcSize - done) / 1000.0 / leftMs : 1e9;
+            if (needed > required) required = needed;
+        }
+
+        int size = LZ4_compress_fast_extState(h->state, src + done, dst + pos + 4,
+                                              inSize, inSize - 1, h->acceleration);
+        if (size <= 0) {
+            memcpy(dst + pos + 4, src + done, inSize);
+            lz4_write_le32(dst + pos, 0x80000000U | (uint32_t)inSize);
+            size = inSize;
+        } else {
+            lz4_write_le32(dst + pos, (uint32_t)size);
+        }
+        pos += 4 + size;
+        done += inSize;
+
+        // Multiplicative steps: speed up quickly when behind, back off
+        // slowly (and only with clear headroom) to avoid oscillating
+        h->windowBytes += inSize;
+        h->windowMs += emscripten_get_now() - now;
+        if (required > 0 && h->windowMs >= LZ4_ADAPTIVE_WINDOW_MS) {
+            double mbps = h->windowBytes / 1000.0 / h->windowMs;
+            h->windowBytes = 0;
+            h->windowMs = 0;
+            if (mbps < required && h->acceleration < LZ4_ADAPTIVE_MAX_ACCELERATION) {
+                h->acceleration *= 2;
+                if (h->acceleration > LZ4_ADAPTIVE_MAX_ACCELERATION) {
+                    h->acceleration = LZ4_ADAPTIVE_MAX_ACCELERATION;
+                }
+            } else if (mbps > required * 1.5 && h->acceleration > 1) {
+                h->acceleration = h->acceleration * 3 / 4;
+                if (h->acceleration < 1) h->acceleration = 1;
+            }
+        }
+    }
+
+    lz4_write_le32(dst + pos, 0);  // end mark
+    pos += 4;
+
+    double totalMs = emscripten_get_now() - start;
+    h->lastMBps = totalMs > 0 ? srcSize / 1000.0 / totalMs : 0;
+    h->outSize = pos;
+    return (int)pos;
+}
+
+// Current acceleration (used for the next block)
+EMSCRIPTEN_KEEPALIVE
+int lz4_adaptive_acceleration(lz4_adaptive* h) {
+    return h->acceleration;
+}
+
+// Measured throughput of the last call in MB/s
+EMSCRIPTEN_KEEPALIVE
+double lz4_adaptive_last_mbps(lz4_adaptive* h) {
+    return h->lastMBps;
+}
+
+EMSCRIPTEN_KEEPALIVE
+char* lz4_adaptive_output(lz4_adaptive* h) {
+    return h->out;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_adaptive_output_size(lz4_adaptive* h) {
+    return (int)h->outSize;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_adaptive_free(lz4_adaptive* h) {
+    if (!h) return;
+    LZ4_freeStream(h->state);
+    free(h->out);
+    free(h);
+}
+
+// ---------------------------------------------------------------------------
+// Seekable archive
+//
+// A block-parallel frame (independent fixed-size blocks) followed by a
+// skippable frame holding the block index, so the archive stays a valid .lz4
+// file for the CLI. Index layout (little endian, u32):
+//   [0x184D2A5E][payload size][block offset x N][content size][block size]
+//   [N][LZ4_SEEK_MAGIC]
+// Block offsets point at each block's 4-byte header from the archive start.
+// Reading a byte range only decodes the blocks that overlap it, and the last
+// one only up to the needed end (LZ4_decompress_safe_partial).
+// ---------------------------------------------------------------------------
+
+#define LZ4_SKIPPABLE_MAGIC 0x184D2A5EU
+#define LZ4_SEEK_MAGIC 0x53345A4CU  // "LZ4S"
+#define LZ4_SEEK_FOOTER_SIZE 16
+
+typedef struct {
+    const char* archive;
+    int archiveSize;
+    const char* offsets;  // N little-endian u32 entries inside the archive
+    int contentSize;
+    int blockSize;
+    int blockCount;
+    char* scratch;        // one decoded block, for ranges not block-aligned
+} lz4_seekable;
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_seekable_bound(int srcSize, int blockSizeId) {
+    int blockSize = lz4_block_size_from_id(blockSizeId);
+    if (!blockSize) return 0;
+    int nBlocks = (srcSize + blockSize - 1) / blockSize;
+    return lz4_frame_parallel_bound(srcSize, blockSizeId) + 8 + nBlocks * 4 + LZ4_SEEK_FOOTER_SIZE;
+}
+
+// Compress src into a seekable archive (see lz4_frame_compress_parallel for
+// blockSizeId/threads). Smaller blocks = finer random access, lower ratio.
+// Returns: archive size, or negative value if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_seekable_compress(const char* src, int srcSize, char* dst, int dstCapacity,
+                          int blockSizeId, int threads) {
+    int blockSize = lz4_block_size_from_id(blockSizeId);
+    if (!blockSize) return -1;
+    if (dstCapacity < lz4_seekable_bound(srcSize, blockSizeId)) return -2;
+
+    int frameSize = lz4_frame_compress_parallel(src, srcSize, dst, dstCapacity,
+                                                blockSizeId, 0, 1, threads, NULL);
+    if (frameSize < 0) return frameSize;
+
+    int nBlocks = (srcSize + blockSize - 1) / blockSize;
+    char* index = dst + frameSize;
+    lz4_write_le32(index, LZ4_SKIPPABLE_MAGIC);
+    lz4_write_le32(index + 4, (uint32_t)(nBlocks * 4 + LZ4_SEEK_FOOTER_SIZE));
+
+    // Walk the block headers to record where each block starts
+    uint32_t pos = LZ4_FRAME_HEADER_SIZE;
+    for (int i = 0; i < nBlocks; i++) {
+        lz4_write_le32(index + 8 + i * 4, pos);
+        pos += 4 + (lz4_read_le32(dst + pos) & 0x7FFFFFFF);
+    }
+
+    char* footer = index + 8 + nBlocks * 4;
+    lz4_write_le32(footer, (uint32_t)srcSize);
+    lz4_write_le32(footer + 4, (uint32_t)blockSize);
+    lz4_write_le32(footer + 8, (uint32_t)nBlocks);
+    lz4_write_le32(footer + 12, LZ4_SEEK_MAGIC);
+    return frameSize + 8 + nBlocks * 4 + LZ4_SEEK_FOOTER_SIZE;
+}
+
+// Open an archive held in the WASM heap (not copied: keep it alive until
+// lz4_seekable_free). Returns NULL if the index is missing or inconsistent.
+EMSCRIPTEN_KEEPALIVE
+lz4_seekable* lz4_seekable_open(const char* archive, int archiveSize) {
+    if (archiveSize < 4 + LZ4_SEEK_FOOTER_SIZE + 8) return NULL;
+    if (lz4_read_le32(archive) != LZ4_FRAME_MAGIC) return NULL;
+
+    const char* footer = archive + archiveSize - LZ4_SEEK_FOOTER_SIZE;
+    if (lz4_read_le32(footer + 12) != LZ4_SEEK_MAGIC) return NULL;
+
+    int contentSize = (int)lz4_read_le32(footer);
+    int blockSize = (int)lz4_read_le32(footer + 4);
+    int blockCount = (int)lz4_read_le32(footer + 8);
+    if (blockSize <= 0 || contentSize < 0 ||
+        blockCount != (int)(((long long)contentSize + blockSize - 1) / blockSize)) {
+        return NULL;
+    }
+
+    long long indexStart = (long long)archiveSize - LZ4_SEEK_FOOTER_SIZE - (long long)blockCount * 4 - 8;
+    if (indexStart < 4) return NULL;
+    if (lz4_read_le32(archive + indexStart) != LZ4_SKIPPABLE_MAGIC) return NULL;
+
+    lz4_seekable* h = (lz4_seekable*)calloc(1, sizeof(lz4_seekable));
+    if (!h) return NULL;
+    h->scratch = (char*)malloc(blockSize);
+    if (!h->scratch) {
+        free(h);
+        return NULL;
+    }
+    h->archive = archive;
+    h->archiveSize = (int)indexStart;  // blocks must lie before the index
+    h->offsets = archive + indexStart + 8;
+    h->contentSize = contentSize;
+    h->blockSize = blockSize;
+    h->blockCount = blockCount;
+    return h;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_seekable_content_size(lz4_seekable* h) {
+    return h->contentSize;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_seekable_block_size(lz4_seekable* h) {
+    return h->blockSize;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_seekable_block_count(lz4_seekable* h) {
+    return h->blockCount;
+}
+
+// Archive offset of block i's header, e.g. to range-fetch only the needed
+// compressed bytes from storage (block i ends where block i + 1 starts)
+EMSCRIPTEN_KEEPALIVE
+int lz4_seekable_block_offset(lz4_seekable* h, int i) {
+    if (i < 0 || i >= h->blockCount) return -1;
+    return (int)lz4_read_le32(h->offsets + i * 4);
+}
+
+// Decode the first `wanted` bytes of block i into out (capacity: block size)
+// Returns: bytes decoded, or negative value if error
+static int lz4_seekable_decode_block(lz4_seekable* h, int i, char* out, int wanted) {
+    uint32_t offset = lz4_read_le32(h->offsets + i * 4);
+    if ((long long)offset + 4 > h->archiveSize) return -1;
+
+    uint32_t header = lz4_read_le32(h->archive + offset);
+    int stored = (int)(header & 0x7FFFFFFF);
+    if ((long long)offset + 4 + stored > h->archiveSize) return -1;
+
+    const char* data = h->archive + offset + 4;
+    int blockLen = h->contentSize - i * h->blockSize;
+    if (blockLen > h->blockSize) blockLen = h->blockSize;
+    if (wanted > blockLen) wanted = blockLen;
+
+    if (header & 0x80000000U) {
+        if (stored < wanted) return -1;
+        memcpy(out, data, wanted);
+        return wanted;
+    }
+    // out may only hold `wanted` bytes (the tail of a caller's range buffer)
+    int n = LZ4_decompress_safe_partial(data, out, stored, wanted, wanted);
+    return n < wanted ? -1 : wanted;
+}
+
+// Copy uncompressed bytes [offset, offset + length) into dst
+// Returns: bytes written, or negative value if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_seekable_read(lz4_seekable* h, int offset, int length, char* dst) {
+    if (offset < 0 || length < 0 || offset > h->contentSize) return -1;
+    if (length > h->contentSize - offset) length = h->contentSize - offset;
+    if (length == 0) return 0;
+
+    int end = offset + length;
+    int written = 0;
+    for (int i = offset / h->blockSize; i * h->blockSize < end; i++) {
+        int blockStart = i * h->blockSize;
+        int from = offset > blockStart ? offset - blockStart : 0;
+        int to = end - blockStart < h->blockSize ? end - blockStart : h->blockSize;
+
+        if (from == 0) {
+            // Range covers the block from its start: decode in place
+            if (lz4_seekable_decode_block(h, i, dst + written, to) < 0) return -2;
+        } else {
+            if (lz4_seekable_decode_block(h, i, h->scratch, to) < 0) return -2;
+            memcpy(dst + written, h->scratch + from, to - from);
+        }
+        written += to - from;
+    }
+    return written;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_seekable_free(lz4_seekable* h) {
+    if (!h) return;
+    free(h->scratch);
+    free(h);
+}
+
+// ---------------------------------------------------------------------------
+// Ring-buffer block stream
+//
+// Linked LZ4 blocks (each may reference the previous 64KB) with a size
+// prefix, for chunked network input: the decoder works in a fixed ring
+// buffer of 64KB + max block size, so memory and time-to-first-byte do not
+// depend on payload size. Stream layout (little endian, u32):
+//   [LZ4_RING_MAGIC][max block size] ([compressed size][block])* [0]
+// ---------------------------------------------------------------------------
+
+#define LZ4_RING_MAGIC 0x52345A4CU  // "LZ4R"
+#define LZ4_RING_HEADER_SIZE 8
+#define LZ4_RING_MIN_BLOCK 1024
+#define LZ4_RING_MAX_BLOCK (4 * 1024 * 1024)
+
+typedef struct {
+    LZ4_stream_t* stream;
+    char* ring;
+    int ringSize;
+    int ringPos;      // start of the block being filled
+    int pending;      // bytes of it filled so far
+    int blockSize;
+    int headerWritten;
+    char* out;
+    size_t outCapacity;
+    size_t outSize;
+} lz4_ring_encoder;
+
+typedef struct {
+    LZ4_streamDecode_t* stream;
+    char header[LZ4_RING_HEADER_SIZE];
+    int headerHave;
+    int maxBlock;
+    char* ring;
+    int ringSize;
+    int ringPos;
+    char sizeBuf[4];
+    int sizeHave;
+    char* staging;    // compressed block split across chunks
+    int stagingHave;
+    int finished;
+    const char* out;  // points into the ring
+    int outSize;
+} lz4_ring_decoder;
+
+// blockSize: 1KB - 4MB (0 = 64KB). Smaller blocks reach the reader sooner.
+EMSCRIPTEN_KEEPALIVE
+lz4_ring_encoder* lz4_ring_encoder_create(int blockSize) {
+    if (blockSize == 0) blockSize = 65536;
+    if (blockSize < LZ4_RING_MIN_BLOCK || blockSize > LZ4_RING_MAX_BLOCK) return NULL;
+
+    lz4_ring_encoder* enc = (lz4_ring_encoder*)calloc(1, sizeof(lz4_ring_encoder));
+    if (!enc) return NULL;
+
+    enc->blockSize = blockSize;
+    // 64KB history + 2 blocks: after a wrap, the new block at the start of
+    // the ring can't overlap the last 64KB it may still reference
+    enc->ringSize = 65536 + 2 * blockSize;
+    enc->ring = (char*)malloc(enc->ringSize);
+    enc->stream = LZ4_createStream();
+    if (!enc->ring || !enc->stream) {
+        free(enc->ring);
+        LZ4_freeStream(enc->stream);
+        free(enc);
+        return NULL;
+    }
+    return enc;
+}
+
+// Compress the pending (possibly partial) block from the ring into out
+static int lz4_ring_emit_block(lz4_ring_encoder* enc) {
+    if (enc->pending == 0) return 0;
+
+    int bound = LZ4_compressBound(enc->pending);
+    if (!lz4_frame_reserve(&enc->out, &enc->outCapacity, enc->outSize + 4 + bound)) return -1;
+
+    char* dst = enc->out + enc->outSize;
+    int size = LZ4_compress_fast_continue(enc->stream, enc->ring + enc->ringPos, dst + 4,
+                                          enc->pending, bound, 1);
+    if (size <= 0) return -2;
+    lz4_write_le32(dst, (uint32_t)size);
+    enc->outSize += 4 + size;
+
+    // Previous blocks must stay in place while they serve as dictionary;
+    // wrap only when a full block no longer fits
+    enc->ringPos += enc->pending;
+    enc->pending = 0;
+    if (enc->ringPos + enc->blockSize > enc->ringSize) enc->ringPos = 0;
+    return 0;
+}
+
+static int lz4_ring_write_header(lz4_ring_encoder* enc) {
+    if (enc->headerWritten) return 0;
+    if (!lz4_frame_reserve(&enc->out, &enc->outCapacity, enc->outSize + LZ4_RING_HEADER_SIZE)) return -1;
+    lz4_write_le32(enc->out + enc->outSize, LZ4_RING_MAGIC);
+    lz4_write_le32(enc->out + enc->outSize + 4, (uint32_t)enc->blockSize);
+    enc->outSize += LZ4_RING_HEADER_SIZE;
+    enc->headerWritten = 1;
+    return 0;
+}
+
+// Feed input; emits every block that fills up
+// Returns: bytes produced, or negative value if error
+EMSCRIPTEN_KEEPALIVE
+int lz4_ring_encoder_update(lz4_ring_encoder* enc, const char* src, int srcSize) {
+    enc->outSize = 0;
+    if (lz4_ring_write_header(enc) < 0) return -1;
+
+    while (srcSize > 0) {
+        int take = enc->blockSize - enc->pending;
+        if (take > srcSize) take = srcSize;
+        memcpy(enc->ring + enc->ringPos + enc->pending, src, take);
+        enc->pending += take;
+        src += take;
+        srcSize -= take;
+
+        if (enc->pending == enc->blockSize) {
+            int err = lz4_ring_emit_block(enc);
+            if (err < 0) return err;
+        }
+    }
+    return (int)enc->outSize;
+}
+
+// Emit the partial block now (e.g. before a network write) without ending
+EMSCRIPTEN_KEEPALIVE
+int lz4_ring_encoder_flush(lz4_ring_encoder* enc) {
+    enc->outSize = 0;
+    if (lz4_ring_write_header(enc) < 0) return -1;
+    int err = lz4_ring_emit_block(enc);
+    return err < 0 ? err : (int)enc->outSize;
+}
+
+// Flush and write the end mark
+EMSCRIPTEN_KEEPALIVE
+int lz4_ring_encoder_end(lz4_ring_encoder* enc) {
+    int produced = lz4_ring_encoder_flush(enc);
+    if (produced < 0) return produced;
+    if (!lz4_frame_reserve(&enc->out, &enc->outCapacity, enc->outSize + 4)) return -1;
+    lz4_write_le32(enc->out + enc->outSize, 0);
+    enc->outSize += 4;
+    return (int)enc->outSize;
+}
+
+EMSCRIPTEN_KEEPALIVE
+char* lz4_ring_encoder_output(lz4_ring_encoder* enc) {
+    return enc->out;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_ring_encoder_output_size(lz4_ring_encoder* enc) {
+    return (int)enc->outSize;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_ring_encoder_free(lz4_ring_encoder* enc) {
+    if (!enc) return;
+    LZ4_freeStream(enc->stream);
+    free(enc->ring);
+    free(enc->out);
+    free(enc);
+}
+
+EMSCRIPTEN_KEEPALIVE
+lz4_ring_decoder* lz4_ring_decoder_create(void) {
+    lz4_ring_decoder* dec = (lz4_ring_decoder*)calloc(1, sizeof(lz4_ring_decoder));
+    if (!dec) return NULL;
+
+    dec->stream = LZ4_createStreamDecode();
+    if (!dec->stream) {
+        free(dec);
+        return NULL;
+    }
+    return dec;
+}
+
+// Consume input up to the end of the next block and decode that block.
+// Call repeatedly with the unconsumed remainder of each chunk; after every
+// call, lz4_ring_decoder_output_size() bytes at lz4_ring_decoder_output()
+// are ready (valid until the next call).
+// Returns: bytes consumed, or negative value if error (-3: the ring buffers
+// could not be allocated; nothing was consumed and the call can be retried)
+EMSCRIPTEN_KEEPALIVE
+int lz4_ring_decoder_update(lz4_ring_decoder* dec, const char* src, int srcSize) {
+    const char* p = src;
+    const char* end = src + srcSize;
+    int headerBefore = dec->headerHave;
+    dec->outSize = 0;
+
+    while (dec->headerHave < LZ4_RING_HEADER_SIZE && p < end) {
+        dec->header[dec->headerHave++] = *p++;
+    }
+    if (dec->headerHave < LZ4_RING_HEADER_SIZE) return (int)(p - src);
+
+    if (!dec->ring) {
+        if (lz4_read_le32(dec->header) != LZ4_RING_MAGIC) return -1;
+        int maxBlock = (int)lz4_read_le32(dec->header + 4);
+        if (maxBlock < LZ4_RING_MIN_BLOCK || maxBlock > LZ4_RING_MAX_BLOCK) return -1;
+
+        // Both buffers or neither: a half-set-up decoder would later decode
+        // through a NULL staging buffer
+        char* ring = (char*)malloc(LZ4_DECODER_RING_BUFFER_SIZE(maxBlock));
+        char* staging = (char*)malloc(LZ4_compressBound(maxBlock));
+        if (!ring || !staging) {
+            free(ring);
+            free(staging);
+            dec->headerHave = headerBefore;
+            return -3;
+        }
+        dec->maxBlock = maxBlock;
+        dec->ringSize = LZ4_DECODER_RING_BUFFER_SIZE(maxBlock);
+        dec->ring = ring;
+        dec->staging = staging;
+        LZ4_setStreamDecode(dec->stream, NULL, 0);
+    }
+    if (dec->finished) return (int)(p - src);
+
+    while (dec->sizeHave < 4 && p < end) {
+        dec->sizeBuf[dec->sizeHave++] = *p++;
+    }
+    if (dec->sizeHave < 4) return (int)(p - src);
+
+    int compressedSize = (int)lz4_read_le32(dec->sizeBuf);
+    if (compressedSize == 0) {
+        dec->finished = 1;
+        return (int)(p - src);
+    }
+    if (compressedSize < 0 || compressedSize > LZ4_compressBound(dec->maxBlock)) return -1;
+
+    // Decode straight from the caller's chunk when the block is all there
+    const char* block;
+    if (dec->stagingHave == 0 && end - p >= compressedSize) {
+        block = p;
+        p += compressedSize;
+    } else {
+        int take = compressedSize - dec->stagingHave;
+        if (take > end - p) take = (int)(end - p);
+        memcpy(dec->staging + dec->stagingHave, p, take);
+        dec->stagingHave += take;
+        p += take;
+        if (dec->stagingHave < compressedSize) return (int)(p - src);
+        block = dec->staging;
+    }
+
+    if (dec->ringPos + dec->maxBlock > dec->ringSize) dec->ringPos = 0;
+    int decoded = LZ4_decompress_safe_continue(dec->stream, block, dec->ring + dec->ringPos,
+                                               compressedSize, dec->maxBlock);
+    if (decoded < 0) return -2;
+
+    dec->out = dec->ring + dec->ringPos;
+    dec->outSize = decoded;
+    dec->ringPos += decoded;
+    dec->sizeHave = 0;
+    dec->stagingHave = 0;
+    return (int)(p - src);
+}
+
+// 1 once the end mark has been read
+EMSCRIPTEN_KEEPALIVE
+int lz4_ring_decoder_finished(lz4_ring_decoder* dec) {
+    return dec->finished;
+}
+
+EMSCRIPTEN_KEEPALIVE
+const char* lz4_ring_decoder_output(lz4_ring_decoder* dec) {
+    return dec->out;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int lz4_ring_decoder_output_size(lz4_ring_decoder* dec) {
+    return dec->outSize;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void lz4_ring_decoder_free(lz4_ring_decoder* dec) {
+    if (!dec) return;
+    LZ4_freeStreamDecode(dec->stream);
+    free(dec->ring);
+    free(dec->staging);
+    free(dec);
+}
@@ -0,0 +1,35 @@
+/**
+ * Shared WASM SIMD build picker for the experiments that ship a simd128
+ * variant next to their scalar build (snappy, xxhash)
+ */
+
+// Smallest module using a v128 instruction (i8x16.splat + i8x16.popcnt)
+const SIMD_PROBE = new Uint8Array([
+    0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0,
+    10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11,
+]);
+
+export const simdSupported = WebAssembly.validate(SIMD_PROBE);
+
+/**
+ * Instantiate the SIMD build if asked for and present, else the scalar one
+ * @param {URL} simdUrl Emscripten ES6 module of the simd128 build
+ * @param {URL} scalarUrl Emscripten ES6 module of the scalar build
+ * @param {boolean} simd Try the SIMD build first
+ * @returns Emscripten module
+ */
+export async function loadVariant(simdUrl, scalarUrl, simd) {
+    if (simd) {
+        let createModule = null;
+        try {
+            createModule = (await import(simdUrl.href)).default;
+        } catch (e) {
+            // Only a missing SIMD build falls back; a SIMD build that is
+            // present but broken must fail loudly, not hide behind scalar
+            if (e?.code !== 'ERR_MODULE_NOT_FOUND' || e.url !== simdUrl.href) throw e;
+        }
+        if (createModule) return await createModule();
+    }
+    const createModule = (await import(scalarUrl.href)).default;
+    return await createModule();
+}
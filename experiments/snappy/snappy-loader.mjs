@@ -0,0 +1,19 @@
+/**
+ * Snappy WASM loader
+ * Picks the simd128 build (snappy-simd.js) when the engine supports WASM
+ * SIMD, and the scalar build (snappy.js) otherwise
+ */
+
+import { simdSupported, loadVariant } from '../simd-loader.mjs';
+
+export { simdSupported };
+
+/**
+ * Instantiate Snappy
+ * @param {{simd?: boolean}} options Force a build (defaults to feature detection)
+ * @returns Emscripten module; module._snappy_wasm_simd() tells which build loaded
+ */
+export default function loadSnappy({ simd = simdSupported } = {}) {
+    return loadVariant(new URL('./snappy-simd.js', import.meta.url),
+                       new URL('./snappy.js', import.meta.url), simd);
+}
@@ -4,13 +4,25 @@
  */
 
 #include <emscripten.h>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <new>
+#include <sys/uio.h>
+#include <atomic>
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <pthread.h>
+#endif
 
 // Need to create the config header that cmake would generate
 #define HAVE_BUILTIN_CTZ 1
 #define HAVE_BUILTIN_EXPECT 1
+// The SIMD build passes -msimd128 -mssse3 -DSNAPPY_HAVE_SSSE3=1: Emscripten
+// lowers the SSSE3 intrinsics snappy uses for pattern copies to simd128
+// (_mm_shuffle_epi8 -> i8x16.swizzle)
+#ifndef SNAPPY_HAVE_SSSE3
 #define SNAPPY_HAVE_SSSE3 0
+#endif
 #define SNAPPY_HAVE_X86_CRC32 0
 #define SNAPPY_HAVE_NEON 0
 #define SNAPPY_HAVE_NEON_CRC32 0
@@ -19,6 +31,8 @@
 
 #include "repo/snappy.h"
 #include "repo/snappy-c.h"
+#include "repo/snappy-sinksource.h"
+#include "repo/snappy-internal.h"  // WorkingMemory, CompressFragment
 
 extern "C" {
 
@@ -80,6 +94,18 @@ int snappy_wasm_validate(const char* compressed, size_t compressed_length) {
     return snappy_validate_compressed_buffer(compressed, compressed_length);
 }
 
+/**
+ * @return 1 if this is the simd128 build, 0 for the scalar build
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_simd() {
+#ifdef __wasm_simd128__
+    return 1;
+#else
+    return 0;
+#endif
+}
+
 /**
  * Get version string
  */
@@ -89,3 +115,1259 @@ const char* snappy_wasm_version() {
 }
 
 } // extern "C"
+
+// ---------------------------------------------------------------------------
+// Framing format (framing_format.txt in the snappy repo)
+//
+// Stream identifier chunk, then chunks of at most 64KB uncompressed data,
+// each with a masked CRC32C of the uncompressed bytes. Handles keep memory
+// constant: the encoder buffers at most one chunk of input, the decoder at
+// most one chunk of compressed data, and each owns a reusable output buffer
+// that JS copies out after every call.
+// ---------------------------------------------------------------------------
+
+namespace {
+
+constexpr size_t kFrameMaxChunkData = 65536;  // uncompressed bytes per chunk
+constexpr size_t kFrameChunkHeader = 4;       // type + 24-bit length
+constexpr size_t kFrameChecksumSize = 4;
+constexpr unsigned char kChunkCompressed = 0x00;
+constexpr unsigned char kChunkUncompressed = 0x01;
+constexpr unsigned char kChunkStreamIdentifier = 0xff;
+const char kStreamIdentifier[] = "\xff\x06\x00\x00sNaPpY";
+constexpr size_t kStreamIdentifierSize = 10;
+
+// CRC32C (Castagnoli), slicing-by-8. The tables are built at compile time,
+// so pthreads workers (see snappy_frame_compress_parallel) never race on a
+// lazy init.
+struct crc32c_tables {
+    uint32_t t[8][256];
+};
+
+constexpr crc32c_tables make_crc32c_tables() {
+    crc32c_tables tables{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0x82F63B78U & (0U - (crc & 1)));
+        tables.t[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            uint32_t prev = tables.t[t - 1][i];
+            tables.t[t][i] = (prev >> 8) ^ tables.t[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr crc32c_tables kCrc32c = make_crc32c_tables();
+static_assert(kCrc32c.t[0][1] == 0xF26B8303U, "CRC32C table");
+constexpr auto& crc32c_table = kCrc32c.t;
+
+uint32_t crc32c(const char* data, size_t n) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    uint32_t crc = 0xFFFFFFFFU;
+    for (; n >= 8; n -= 8, p += 8) {
+        uint32_t lo = crc ^ (p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24);
+        crc = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+              crc32c_table[5][(lo >> 16) & 0xFF] ^ crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][p[4]] ^ crc32c_table[2][p[5]] ^
+              crc32c_table[1][p[6]] ^ crc32c_table[0][p[7]];
+    }
+    while (n--) crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+// The framing format stores a rotated CRC so that CRCs of data that itself
+// contains CRCs stay well distributed
+uint32_t masked_crc32c(const char* data, size_t n) {
+    uint32_t crc = crc32c(data, n);
+    return ((crc >> 15) | (crc << 17)) + 0xa282ead8U;
+}
+
+void write_le24(char* p, uint32_t v) {
+    p[0] = (char)v;
+    p[1] = (char)(v >> 8);
+    p[2] = (char)(v >> 16);
+}
+
+void write_le32(char* p, uint32_t v) {
+    write_le24(p, v);
+    p[3] = (char)(v >> 24);
+}
+
+uint32_t read_le32(const char* p) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return u[0] | u[1] << 8 | u[2] << 16 | (uint32_t)u[3] << 24;
+}
+
+} // namespace
+
+// Handle-owned output buffer; capacity is kept across calls
+struct snappy_buffer {
+    char* data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    // Make room for `extra` more bytes after `size`
+    bool reserve(size_t extra) {
+        size_t needed = size + extra;
+        if (needed <= capacity) return true;
+        size_t grown_capacity = capacity * 2 > needed ? capacity * 2 : needed;
+        char* grown = static_cast<char*>(realloc(data, grown_capacity));
+        if (!grown) return false;
+        data = grown;
+        capacity = grown_capacity;
+        return true;
+    }
+
+    ~snappy_buffer() { free(data); }
+};
+
+struct snappy_frame_encoder {
+    char pending[kFrameMaxChunkData];  // input not yet emitted as a chunk
+    size_t pending_size = 0;
+    bool started = false;              // stream identifier written
+    snappy_buffer out;
+};
+
+struct snappy_frame_decoder {
+    char* chunk = nullptr;             // header + body of the current chunk
+    size_t chunk_size = 0;             // bytes of it buffered so far
+    size_t skip = 0;                   // bytes left of a skippable chunk
+    bool seen_identifier = false;
+    snappy_buffer out;
+
+    ~snappy_frame_decoder() { free(chunk); }
+};
+
+namespace {
+
+// Largest body we accept: a compressed chunk of 64KB worst-case input
+size_t frame_max_chunk_body() {
+    return kFrameChecksumSize + snappy::MaxCompressedLength(kFrameMaxChunkData);
+}
+
+// Finish a chunk whose data was compressed to header + 8 (compressed_length
+// bytes); incompressible data (under 12.5% saved) is stored uncompressed
+// instead, which is also what other framing implementations do
+// Returns: total chunk size
+size_t frame_finish_chunk(char* header, const char* data, size_t n, size_t compressed_length) {
+    char* body = header + kFrameChunkHeader + kFrameChecksumSize;
+    unsigned char type = kChunkCompressed;
+    if (compressed_length >= n - n / 8) {
+        memcpy(body, data, n);
+        compressed_length = n;
+        type = kChunkUncompressed;
+    }
+    header[0] = (char)type;
+    write_le24(header + 1, (uint32_t)(kFrameChecksumSize + compressed_length));
+    write_le32(header + kFrameChunkHeader, masked_crc32c(data, n));
+    return kFrameChunkHeader + kFrameChecksumSize + compressed_length;
+}
+
+// Append one data chunk
+bool frame_emit_chunk(snappy_buffer& out, const char* data, size_t n) {
+    if (!out.reserve(kFrameChunkHeader + frame_max_chunk_body())) return false;
+
+    char* header = out.data + out.size;
+    size_t compressed_length = 0;
+    snappy::RawCompress(data, n, header + kFrameChunkHeader + kFrameChecksumSize, &compressed_length);
+    out.size += frame_finish_chunk(header, data, n, compressed_length);
+    return true;
+}
+
+// Decode one complete chunk (header + body) into out
+// Returns: 0 on success, -1 corrupt/unsupported, -3 checksum mismatch
+int frame_decode_chunk(snappy_frame_decoder* dec) {
+    unsigned char type = (unsigned char)dec->chunk[0];
+    const char* body = dec->chunk + kFrameChunkHeader;
+    size_t body_size = dec->chunk_size - kFrameChunkHeader;
+
+    if (type == kChunkStreamIdentifier) {
+        if (memcmp(dec->chunk, kStreamIdentifier, kStreamIdentifierSize) != 0) return -1;
+        dec->seen_identifier = true;
+        return 0;
+    }
+    if (!dec->seen_identifier || body_size < kFrameChecksumSize) return -1;
+
+    uint32_t expected = read_le32(body);
+    const char* data = body + kFrameChecksumSize;
+    size_t data_size = body_size - kFrameChecksumSize;
+    size_t length = data_size;
+    if (type == kChunkCompressed &&
+        !snappy::GetUncompressedLength(data, data_size, &length)) {
+        return -1;
+    }
+    if (length > kFrameMaxChunkData || !dec->out.reserve(length)) return -1;
+
+    char* dst = dec->out.data + dec->out.size;
+    if (type == kChunkCompressed) {
+        if (!snappy::RawUncompress(data, data_size, dst)) return -1;
+    } else {
+        memcpy(dst, data, length);
+    }
+    if (masked_crc32c(dst, length) != expected) return -3;
+    dec->out.size += length;
+    return 0;
+}
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Create a framing-format encoder
+ * @return Handle, or NULL on allocation failure
+ */
+EMSCRIPTEN_KEEPALIVE
+snappy_frame_encoder* snappy_frame_encoder_create() {
+    return new (std::nothrow) snappy_frame_encoder();
+}
+
+/**
+ * Feed a chunk of input; emits every complete 64KB chunk (the stream
+ * identifier is written before the first one)
+ * @return Bytes available via snappy_frame_encoder_output, or -1 on error
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_frame_encoder_update(snappy_frame_encoder* enc, const char* input, size_t length) {
+    snappy_buffer& out = enc->out;
+    out.size = 0;
+    if (!enc->started) {
+        if (!out.reserve(kStreamIdentifierSize)) return -1;
+        memcpy(out.data, kStreamIdentifier, kStreamIdentifierSize);
+        out.size = kStreamIdentifierSize;
+        enc->started = true;
+    }
+
+    // Top up a partial chunk first, then emit full chunks straight from input
+    if (enc->pending_size > 0 && length > 0) {
+        size_t n = kFrameMaxChunkData - enc->pending_size;
+        if (n > length) n = length;
+        memcpy(enc->pending + enc->pending_size, input, n);
+        enc->pending_size += n;
+        input += n;
+        length -= n;
+        if (enc->pending_size == kFrameMaxChunkData) {
+            if (!frame_emit_chunk(out, enc->pending, kFrameMaxChunkData)) return -1;
+            enc->pending_size = 0;
+        }
+    }
+    while (length >= kFrameMaxChunkData) {
+        if (!frame_emit_chunk(out, input, kFrameMaxChunkData)) return -1;
+        input += kFrameMaxChunkData;
+        length -= kFrameMaxChunkData;
+    }
+    if (length > 0) memcpy(enc->pending + enc->pending_size, input, length);
+    enc->pending_size += length;
+    return (int)out.size;
+}
+
+/**
+ * Flush buffered input as a final chunk. The next update starts a new
+ * stream (with its own stream identifier).
+ * @return Bytes available via snappy_frame_encoder_output, or -1 on error
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_frame_encoder_end(snappy_frame_encoder* enc) {
+    int produced = snappy_frame_encoder_update(enc, nullptr, 0);
+    if (produced < 0) return produced;
+    if (enc->pending_size > 0) {
+        if (!frame_emit_chunk(enc->out, enc->pending, enc->pending_size)) return -1;
+        enc->pending_size = 0;
+    }
+    enc->started = false;
+    return (int)enc->out.size;
+}
+
+EMSCRIPTEN_KEEPALIVE
+char* snappy_frame_encoder_output(snappy_frame_encoder* enc) {
+    return enc->out.data;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t snappy_frame_encoder_output_size(snappy_frame_encoder* enc) {
+    return enc->out.size;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void snappy_frame_encoder_free(snappy_frame_encoder* enc) {
+    delete enc;
+}
+
+/**
+ * Create a framing-format decoder
+ * @return Handle, or NULL on allocation failure
+ */
+EMSCRIPTEN_KEEPALIVE
+snappy_frame_decoder* snappy_frame_decoder_create() {
+    snappy_frame_decoder* dec = new (std::nothrow) snappy_frame_decoder();
+    if (!dec) return nullptr;
+    dec->chunk = static_cast<char*>(malloc(kFrameChunkHeader + frame_max_chunk_body()));
+    if (!dec->chunk) {
+        delete dec;
+        return nullptr;
+    }
+    return dec;
+}
+
+/**
+ * Feed a piece of a framed stream (any size, may split chunks). All of it
+ * is consumed; decoded bytes land in the output buffer. Padding and
+ * reserved skippable chunks are skipped.
+ * @return Bytes available via snappy_frame_decoder_output, -1 if the stream
+ *         is corrupt or uses a reserved unskippable chunk, -3 on a CRC
+ *         mismatch. After an error the handle must be freed.
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_frame_decoder_update(snappy_frame_decoder* dec, const char* input, size_t length) {
+    dec->out.size = 0;
+    while (length > 0) {
+        if (dec->skip > 0) {
+            size_t n = dec->skip < length ? dec->skip : length;
+            dec->skip -= n;
+            input += n;
+            length -= n;
+            continue;
+        }
+
+        // Chunk header
+        if (dec->chunk_size < kFrameChunkHeader) {
+            size_t n = kFrameChunkHeader - dec->chunk_size;
+            if (n > length) n = length;
+            memcpy(dec->chunk + dec->chunk_size, input, n);
+            dec->chunk_size += n;
+            input += n;
+            length -= n;
+            if (dec->chunk_size < kFrameChunkHeader) break;
+        }
+        unsigned char type = (unsigned char)dec->chunk[0];
+        size_t body_size = read_le32(dec->chunk) >> 8;
+        if (type >= 0x80 && type != kChunkStreamIdentifier) {
+            dec->skip = body_size;
+            dec->chunk_size = 0;
+            continue;
+        }
+        if (type > kChunkUncompressed && type != kChunkStreamIdentifier) return -1;
+        if (body_size > frame_max_chunk_body()) return -1;
+
+        // Chunk body
+        size_t total = kFrameChunkHeader + body_size;
+        size_t n = total - dec->chunk_size;
+        if (n > length) n = length;
+        memcpy(dec->chunk + dec->chunk_size, input, n);
+        dec->chunk_size += n;
+        input += n;
+        length -= n;
+        if (dec->chunk_size < total) break;
+
+        int status = frame_decode_chunk(dec);
+        if (status < 0) return status;
+        dec->chunk_size = 0;
+    }
+    return (int)dec->out.size;
+}
+
+/**
+ * @return 1 if the decoder sits between chunks (the stream may end here),
+ *         0 if it is inside a chunk (the stream is truncated if it ends)
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_frame_decoder_at_boundary(snappy_frame_decoder* dec) {
+    return dec->chunk_size == 0 && dec->skip == 0;
+}
+
+EMSCRIPTEN_KEEPALIVE
+char* snappy_frame_decoder_output(snappy_frame_decoder* dec) {
+    return dec->out.data;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t snappy_frame_decoder_output_size(snappy_frame_decoder* dec) {
+    return dec->out.size;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void snappy_frame_decoder_free(snappy_frame_decoder* dec) {
+    delete dec;
+}
+
+} // extern "C"
+
+// ---------------------------------------------------------------------------
+// Scatter/gather
+//
+// Records assembled from several pieces (header, body, trailer) compress
+// straight from their segments, and decompress straight into them, without
+// a contiguous staging copy. The iovec table lives in the WASM heap: on
+// wasm32 a struct iovec is two 32-bit words, [pointer, length].
+// ---------------------------------------------------------------------------
+
+extern "C" {
+
+/**
+ * Compress the concatenation of iov_count heap segments
+ * @param iov Table of iov_count {pointer, length} entries
+ * @param iov_count Number of segments
+ * @param output Pre-allocated output buffer (max_compressed_length of the total)
+ * @param output_length Pointer to output length (in: capacity, out: actual size)
+ * @return 0 on success, 2 if the output buffer is too small
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_compress_iov(const struct iovec* iov, size_t iov_count,
+                             char* output, size_t* output_length) {
+    size_t total = 0;
+    for (size_t i = 0; i < iov_count; i++) total += iov[i].iov_len;
+    if (*output_length < snappy::MaxCompressedLength(total)) return SNAPPY_BUFFER_TOO_SMALL;
+
+    snappy::RawCompressFromIOVec(iov, total, output, output_length);
+    return SNAPPY_OK;
+}
+
+/**
+ * Decompress into iov_count heap segments, filled in order
+ * @param input Compressed input
+ * @param input_length Length of compressed input
+ * @param iov Table of iov_count {pointer, length} entries
+ * @param iov_count Number of segments
+ * @return 0 on success, 1 if the input is invalid, 2 if the segments are
+ *         too small in total
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_uncompress_iov(const char* input, size_t input_length,
+                               const struct iovec* iov, size_t iov_count) {
+    size_t needed = 0;
+    if (!snappy::GetUncompressedLength(input, input_length, &needed)) return SNAPPY_INVALID_INPUT;
+    size_t total = 0;
+    for (size_t i = 0; i < iov_count; i++) total += iov[i].iov_len;
+    if (total < needed) return SNAPPY_BUFFER_TOO_SMALL;
+
+    return snappy::RawUncompressToIOVec(input, input_length, iov, iov_count)
+               ? SNAPPY_OK : SNAPPY_INVALID_INPUT;
+}
+
+} // extern "C"
+
+// ---------------------------------------------------------------------------
+// Single-call decompression
+//
+// snappy_wasm_uncompress needs a separate snappy_wasm_uncompressed_length
+// call and a JS-managed output allocation. Here the output either goes into
+// a caller region in the heap, or into a growable snappy_buffer handle via a
+// snappy::Sink: snappy::Uncompress asks the sink for the whole uncompressed
+// size up front, so it decodes straight into the handle's buffer.
+// ---------------------------------------------------------------------------
+
+namespace {
+
+class BufferSink : public snappy::Sink {
+public:
+    explicit BufferSink(snappy_buffer& buffer) : buffer_(buffer) {}
+
+    void Append(const char* bytes, size_t n) override {
+        // Bytes already written in place by the decoder just get committed
+        if (bytes != buffer_.data + buffer_.size) {
+            if (!buffer_.reserve(n)) {
+                failed_ = true;
+                return;
+            }
+            memcpy(buffer_.data + buffer_.size, bytes, n);
+        }
+        buffer_.size += n;
+    }
+
+    char* GetAppendBuffer(size_t length, char* scratch) override {
+        return buffer_.reserve(length) ? buffer_.data + buffer_.size : scratch;
+    }
+
+    char* GetAppendBufferVariable(size_t min_size, size_t desired_size_hint, char* scratch,
+                                  size_t scratch_size, size_t* allocated_size) override {
+        size_t wanted = desired_size_hint > min_size ? desired_size_hint : min_size;
+        if (!buffer_.reserve(wanted)) {
+            *allocated_size = scratch_size;
+            return scratch;
+        }
+        *allocated_size = buffer_.capacity - buffer_.size;
+        return buffer_.data + buffer_.size;
+    }
+
+    bool failed() const { return failed_; }
+
+private:
+    snappy_buffer& buffer_;
+    bool failed_ = false;
+};
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Decompress into a caller-owned heap region in one call (no separate
+ * uncompressed-length call)
+ * @param input Compressed input
+ * @param input_length Length of compressed input
+ * @param output Output region (e.g. a view over a preallocated heap pool)
+ * @param output_capacity Size of the output region
+ * @return Decompressed size, -1 if the input is invalid, -2 if the region
+ *         is too small (fall back to snappy_wasm_uncompress_to_buffer)
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_uncompress_into(const char* input, size_t input_length,
+                                char* output, size_t output_capacity) {
+    size_t length = 0;
+    if (!snappy::GetUncompressedLength(input, input_length, &length)) return -1;
+    if (length > output_capacity) return -2;
+    return snappy::RawUncompress(input, input_length, output) ? (int)length : -1;
+}
+
+/**
+ * Create a growable output buffer; its capacity is kept across calls
+ * @return Handle, or NULL on allocation failure
+ */
+EMSCRIPTEN_KEEPALIVE
+snappy_buffer* snappy_buffer_create() {
+    return new (std::nothrow) snappy_buffer();
+}
+
+/**
+ * Decompress into the buffer (replacing its contents), growing it as needed
+ * @param buffer Output buffer handle
+ * @param input Compressed input
+ * @param input_length Length of compressed input
+ * @return Decompressed size (also snappy_buffer_size), or -1 on error
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_uncompress_to_buffer(snappy_buffer* buffer, const char* input, size_t input_length) {
+    buffer->size = 0;
+    snappy::ByteArraySource source(input, input_length);
+    BufferSink sink(*buffer);
+    if (!snappy::Uncompress(&source, &sink) || sink.failed()) {
+        buffer->size = 0;
+        return -1;
+    }
+    return (int)buffer->size;
+}
+
+EMSCRIPTEN_KEEPALIVE
+char* snappy_buffer_data(snappy_buffer* buffer) {
+    return buffer->data;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t snappy_buffer_size(snappy_buffer* buffer) {
+    return buffer->size;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void snappy_buffer_free(snappy_buffer* buffer) {
+    delete buffer;
+}
+
+} // extern "C"
+
+// ---------------------------------------------------------------------------
+// Reusable compressor + batch API
+//
+// Every snappy_compress call constructs a WorkingMemory (hash table plus
+// scratch buffers) and frees it again. A compressor handle owns one, sized
+// for a full 64KB block, and runs the same per-fragment loop as
+// snappy::RawCompress at the handle's level, so the output is byte-identical.
+// The batch call compresses N messages described by an offset/length table
+// in one boundary crossing. Uses snappy-internal.h, so recheck on snappy
+// upgrades.
+// ---------------------------------------------------------------------------
+
+struct snappy_compressor {
+    snappy::internal::WorkingMemory wmem{snappy::kBlockSize};
+    int level = snappy::CompressionOptions::DefaultCompressionLevel();
+};
+
+namespace {
+
+char* write_varint32(char* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (char)v;
+    return p;
+}
+
+// output must hold MaxCompressedLength(input_length) bytes
+size_t compressor_compress(snappy_compressor* c, const char* input, size_t input_length,
+                           char* output) {
+    char* op = write_varint32(output, (uint32_t)input_length);
+    while (input_length > 0) {
+        size_t fragment = input_length < snappy::kBlockSize ? input_length : snappy::kBlockSize;
+        int table_size = 0;
+        uint16_t* table = c->wmem.GetHashTable(fragment, &table_size);
+        if (c->level == 2) {
+            // Level 2 splits the table in two (see snappy::Compress)
+            int half = table_size >> 1;
+            op = snappy::internal::CompressFragmentDoubleHash(input, fragment, op, table, half,
+                                                              table + half, half);
+        } else {
+            op = snappy::internal::CompressFragment(input, fragment, op, table, table_size);
+        }
+        input += fragment;
+        input_length -= fragment;
+    }
+    return (size_t)(op - output);
+}
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Create a compressor that reuses its working memory across calls
+ * @return Handle, or NULL on allocation failure
+ */
+EMSCRIPTEN_KEEPALIVE
+snappy_compressor* snappy_compressor_create() {
+    return new (std::nothrow) snappy_compressor();
+}
+
+/**
+ * Compress data (same output as snappy_wasm_compress)
+ * @param c Compressor handle
+ * @param input Input data
+ * @param input_length Length of input
+ * @param output Pre-allocated output buffer
+ * @param output_length Pointer to output length (in: capacity, out: actual size)
+ * @return 0 on success, 2 if the output buffer is too small
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_compressor_compress(snappy_compressor* c, const char* input, size_t input_length,
+                               char* output, size_t* output_length) {
+    if (*output_length < snappy::MaxCompressedLength(input_length)) return SNAPPY_BUFFER_TOO_SMALL;
+    *output_length = compressor_compress(c, input, input_length, output);
+    return SNAPPY_OK;
+}
+
+/**
+ * Worst-case output size for a batch (sum of per-message bounds)
+ * @param table count pairs of [offset, length]
+ * @param count Number of messages
+ */
+EMSCRIPTEN_KEEPALIVE
+size_t snappy_wasm_max_compressed_batch_length(const int* table, int count) {
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += snappy::MaxCompressedLength((size_t)table[i * 2 + 1]);
+    }
+    return total;
+}
+
+/**
+ * Compress count independent messages in one call
+ * @param c Compressor handle
+ * @param input Base of the inputs
+ * @param table count pairs of [offset, length] into input
+ * @param count Number of messages
+ * @param output Outputs are packed back to back
+ * @param output_capacity Size of output
+ * @param out_table Receives count pairs of [offset, compressed length] into output
+ * @return Total bytes written, or -(i + 1) if message i did not fit
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_compressor_compress_batch(snappy_compressor* c, const char* input, const int* table,
+                                     int count, char* output, size_t output_capacity,
+                                     int* out_table) {
+    size_t written = 0;
+    for (int i = 0; i < count; i++) {
+        size_t length = (size_t)table[i * 2 + 1];
+        if (output_capacity - written < snappy::MaxCompressedLength(length)) return -(i + 1);
+
+        size_t size = compressor_compress(c, input + table[i * 2], length, output + written);
+        out_table[i * 2] = (int)written;
+        out_table[i * 2 + 1] = (int)size;
+        written += size;
+    }
+    return (int)written;
+}
+
+/**
+ * Set the compression level for later calls (see snappy_wasm_compress_level)
+ */
+EMSCRIPTEN_KEEPALIVE
+void snappy_compressor_set_level(snappy_compressor* c, int level) {
+    c->level = level >= 2 ? 2 : 1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void snappy_compressor_free(snappy_compressor* c) {
+    delete c;
+}
+
+} // extern "C"
+
+// ---------------------------------------------------------------------------
+// Parallel framed compression
+//
+// Framing-format chunks are independent, so a large buffer is split into
+// 64KB chunks that a pthread pool compresses (pthreads build, see
+// LEARNINGS.md; without pthreads everything runs on the calling thread).
+// Workers pull chunk indices from an atomic counter, each with its own
+// compressor, and write chunk i straight into its worst-case slot in the
+// output; the calling thread then compacts the slots in order.
+// ---------------------------------------------------------------------------
+
+namespace {
+
+constexpr int kParallelMaxThreads = 64;
+
+size_t frame_slot_size() {
+    return kFrameChunkHeader + frame_max_chunk_body();
+}
+
+struct frame_parallel_job {
+    const char* input;
+    size_t length;
+    size_t chunks;
+    char* slots;         // output + stream identifier
+    size_t* sizes;       // final size of each chunk
+    std::atomic<size_t> next{0};
+};
+
+void* frame_parallel_worker(void* arg) {
+    frame_parallel_job* job = static_cast<frame_parallel_job*>(arg);
+    snappy_compressor* c = new (std::nothrow) snappy_compressor();
+    for (;;) {
+        size_t i = job->next.fetch_add(1);
+        if (i >= job->chunks) break;
+
+        const char* data = job->input + i * kFrameMaxChunkData;
+        size_t n = job->length - i * kFrameMaxChunkData;
+        if (n > kFrameMaxChunkData) n = kFrameMaxChunkData;
+        char* header = job->slots + i * frame_slot_size();
+        char* body = header + kFrameChunkHeader + kFrameChecksumSize;
+
+        size_t compressed_length = 0;
+        if (c) {
+            compressed_length = compressor_compress(c, data, n, body);
+        } else {
+            snappy::RawCompress(data, n, body, &compressed_length);
+        }
+        job->sizes[i] = frame_finish_chunk(header, data, n, compressed_length);
+    }
+    delete c;
+    return nullptr;
+}
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Worst-case output size for snappy_frame_compress_parallel
+ */
+EMSCRIPTEN_KEEPALIVE
+size_t snappy_frame_parallel_bound(size_t length) {
+    size_t chunks = (length + kFrameMaxChunkData - 1) / kFrameMaxChunkData;
+    return kStreamIdentifierSize + chunks * frame_slot_size();
+}
+
+/**
+ * Compress a whole buffer into a framing-format stream using up to
+ * `threads` threads (decodable by snappy_frame_decoder_update and any other
+ * framed-snappy reader)
+ * @param input Input data
+ * @param length Length of input
+ * @param output Output buffer, at least snappy_frame_parallel_bound(length)
+ * @param output_capacity Size of output
+ * @param threads Worker threads (1 = calling thread only)
+ * @return Stream size, -2 if output is too small, -3 on allocation failure
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_frame_compress_parallel(const char* input, size_t length, char* output,
+                                   size_t output_capacity, int threads) {
+    if (output_capacity < snappy_frame_parallel_bound(length)) return -2;
+
+    frame_parallel_job job;
+    job.input = input;
+    job.length = length;
+    job.chunks = (length + kFrameMaxChunkData - 1) / kFrameMaxChunkData;
+    job.slots = output + kStreamIdentifierSize;
+    job.sizes = static_cast<size_t*>(malloc(sizeof(size_t) * (job.chunks + 1)));
+    if (!job.sizes) return -3;
+
+    if (threads < 1) threads = 1;
+    if (threads > kParallelMaxThreads) threads = kParallelMaxThreads;
+    if ((size_t)threads > job.chunks) threads = job.chunks > 0 ? (int)job.chunks : 1;
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+    pthread_t workers[kParallelMaxThreads];
+    int started = 0;
+    while (started < threads &&
+           pthread_create(&workers[started], nullptr, frame_parallel_worker, &job) == 0) {
+        started++;
+    }
+    // No thread could be started: compress everything on this thread
+    if (started == 0) frame_parallel_worker(&job);
+    for (int t = 0; t < started; t++) pthread_join(workers[t], nullptr);
+#else
+    frame_parallel_worker(&job);
+#endif
+
+    // Compact slots in order; a chunk's final position never passes its
+    // slot, so a forward memmove is safe
+    memcpy(output, kStreamIdentifier, kStreamIdentifierSize);
+    size_t pos = kStreamIdentifierSize;
+    for (size_t i = 0; i < job.chunks; i++) {
+        memmove(output + pos, job.slots + i * frame_slot_size(), job.sizes[i]);
+        pos += job.sizes[i];
+    }
+
+    free(job.sizes);
+    return (int)pos;
+}
+
+} // extern "C"
+
+// ---------------------------------------------------------------------------
+// Block-indexed record container
+//
+// Records are packed into blocks of roughly block_size uncompressed bytes,
+// each compressed as one snappy buffer. A block holds its records back to
+// back followed by a u32 end offset per record; an index footer lists every
+// block's offset and record count:
+//
+//   [block 0]...[block N-1][N x (u32 offset, u32 records)]
+//   [u32 N][u32 total records][u32 magic "SNPC"]
+//
+// Fetching record i decompresses exactly one block (the last block stays
+// cached, so neighbouring lookups are free).
+// ---------------------------------------------------------------------------
+
+namespace {
+
+constexpr uint32_t kContainerMagic = 0x43504E53U;  // "SNPC"
+constexpr size_t kContainerTrailerSize = 12;
+constexpr size_t kContainerIndexEntry = 8;
+
+} // namespace
+
+struct snappy_container_builder {
+    size_t block_size;
+    snappy_compressor compressor;
+    snappy_buffer block;          // pending records + their end offsets
+    uint32_t* ends = nullptr;     // end offsets of the pending records
+    size_t ends_capacity = 0;
+    uint32_t block_records = 0;
+    snappy_buffer index;          // (offset, records) per finished block
+    uint32_t blocks = 0;
+    uint32_t records = 0;
+    snappy_buffer out;
+    bool finished = false;        // out holds a finished container
+
+    ~snappy_container_builder() { free(ends); }
+};
+
+struct snappy_container {
+    const char* data;
+    size_t size;
+    uint32_t blocks;
+    uint32_t records;
+    const char* index;            // points into data
+    uint32_t* first_record;       // blocks + 1 entries (prefix sums)
+    int cached_block = -1;
+    snappy_buffer cache;          // decompressed cached block
+    const char* record = nullptr; // last record returned by get
+
+    ~snappy_container() { free(first_record); }
+};
+
+namespace {
+
+// Drop everything, including a finished container, and start a new one
+void container_restart(snappy_container_builder* b) {
+    b->out.size = 0;
+    b->block.size = 0;
+    b->block_records = 0;
+    b->index.size = 0;
+    b->blocks = 0;
+    b->records = 0;
+    b->finished = false;
+}
+
+// Compress the pending records as one block
+bool container_flush_block(snappy_container_builder* b) {
+    if (b->block_records == 0) return true;
+
+    snappy_buffer& block = b->block;
+    if (!block.reserve(b->block_records * 4)) return false;
+    for (uint32_t i = 0; i < b->block_records; i++) {
+        write_le32(block.data + block.size + i * 4, b->ends[i]);
+    }
+    block.size += b->block_records * 4;
+
+    snappy_buffer& out = b->out;
+    if (!out.reserve(snappy::MaxCompressedLength(block.size)) ||
+        !b->index.reserve(kContainerIndexEntry)) {
+        return false;
+    }
+    write_le32(b->index.data + b->index.size, (uint32_t)out.size);
+    write_le32(b->index.data + b->index.size + 4, b->block_records);
+    b->index.size += kContainerIndexEntry;
+    out.size += compressor_compress(&b->compressor, block.data, block.size, out.data + out.size);
+
+    b->blocks++;
+    b->block_records = 0;
+    block.size = 0;
+    return true;
+}
+
+// Decompress block i into the cache and check its end-offset table
+bool container_load_block(snappy_container* c, uint32_t block) {
+    if (c->cached_block == (int)block) return true;
+    c->cached_block = -1;
+
+    const char* entry = c->index + block * kContainerIndexEntry;
+    size_t start = read_le32(entry);
+    size_t end = block + 1 < c->blocks ? read_le32(entry + kContainerIndexEntry)
+                                       : (size_t)(c->index - c->data);
+    uint32_t count = read_le32(entry + 4);
+    if (start > end || end > (size_t)(c->index - c->data)) return false;
+
+    size_t length = 0;
+    if (!snappy::GetUncompressedLength(c->data + start, end - start, &length) ||
+        length < (size_t)count * 4) {
+        return false;
+    }
+    c->cache.size = 0;
+    if (!c->cache.reserve(length) ||
+        !snappy::RawUncompress(c->data + start, end - start, c->cache.data)) {
+        return false;
+    }
+    c->cache.size = length;
+
+    size_t payload = length - (size_t)count * 4;
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t record_end = read_le32(c->cache.data + payload + i * 4);
+        if (record_end < previous || record_end > payload) return false;
+        previous = record_end;
+    }
+    c->cached_block = (int)block;
+    return true;
+}
+
+} // namespace
+
+extern "C" {
+
+/**
+ * Create a container builder
+ * @param block_size Target uncompressed bytes per block (larger = better
+ *                   ratio, smaller = cheaper lookups); 0 = 64KB
+ * @return Handle, or NULL on allocation failure
+ */
+EMSCRIPTEN_KEEPALIVE
+snappy_container_builder* snappy_container_builder_create(size_t block_size) {
+    snappy_container_builder* b = new (std::nothrow) snappy_container_builder();
+    if (!b) return nullptr;
+    b->block_size = block_size > 0 ? block_size : snappy::kBlockSize;
+    return b;
+}
+
+/**
+ * Append a record; a block is compressed whenever it reaches block_size
+ * @return Index of the record, or -1 on error
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_container_add(snappy_container_builder* b, const char* record, size_t length) {
+    if (b->finished) container_restart(b);
+    if (b->block_records == b->ends_capacity) {
+        size_t capacity = b->ends_capacity ? b->ends_capacity * 2 : 256;
+        uint32_t* grown = static_cast<uint32_t*>(realloc(b->ends, capacity * sizeof(uint32_t)));
+        if (!grown) return -1;
+        b->ends = grown;
+        b->ends_capacity = capacity;
+    }
+    if (!b->block.reserve(length)) return -1;
+
+    if (length > 0) memcpy(b->block.data + b->block.size, record, length);
+    b->block.size += length;
+    b->ends[b->block_records++] = (uint32_t)b->block.size;
+    if (b->block.size >= b->block_size && !container_flush_block(b)) return -1;
+    return (int)b->records++;
+}
+
+/**
+ * Compress the last block and write the index footer. The container stays
+ * at snappy_container_builder_output until the next add or finish, which
+ * start a new container from offset 0.
+ * @return Container size (bytes at snappy_container_builder_output), or -1
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_container_finish(snappy_container_builder* b) {
+    if (b->finished) container_restart(b);
+    if (!container_flush_block(b)) return -1;
+
+    snappy_buffer& out = b->out;
+    if (!out.reserve(b->index.size + kContainerTrailerSize)) return -1;
+    if (b->index.size > 0) memcpy(out.data + out.size, b->index.data, b->index.size);
+    out.size += b->index.size;
+    write_le32(out.data + out.size, b->blocks);
+    write_le32(out.data + out.size + 4, b->records);
+    write_le32(out.data + out.size + 8, kContainerMagic);
+    out.size += kContainerTrailerSize;
+    b->finished = true;
+    return (int)out.size;
+}
+
+EMSCRIPTEN_KEEPALIVE
+char* snappy_container_builder_output(snappy_container_builder* b) {
+    return b->out.data;
+}
+
+/**
+ * Discard the container being built (or the finished one)
+ */
+EMSCRIPTEN_KEEPALIVE
+void snappy_container_builder_reset(snappy_container_builder* b) {
+    container_restart(b);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void snappy_container_builder_free(snappy_container_builder* b) {
+    delete b;
+}
+
+/**
+ * Open a container held in the WASM heap (not copied: keep it alive until
+ * snappy_container_free)
+ * @return Handle, or NULL if the footer/index is invalid
+ */
+EMSCRIPTEN_KEEPALIVE
+snappy_container* snappy_container_open(const char* data, size_t size) {
+    if (size < kContainerTrailerSize) return nullptr;
+    const char* trailer = data + size - kContainerTrailerSize;
+    uint32_t blocks = read_le32(trailer);
+    uint32_t records = read_le32(trailer + 4);
+    if (read_le32(trailer + 8) != kContainerMagic ||
+        blocks > (size - kContainerTrailerSize) / kContainerIndexEntry) {
+        return nullptr;
+    }
+
+    snappy_container* c = new (std::nothrow) snappy_container();
+    if (!c) return nullptr;
+    c->data = data;
+    c->size = size;
+    c->blocks = blocks;
+    c->records = records;
+    c->index = trailer - (size_t)blocks * kContainerIndexEntry;
+    c->first_record = static_cast<uint32_t*>(malloc(sizeof(uint32_t) * (blocks + 1)));
+    if (!c->first_record) {
+        delete c;
+        return nullptr;
+    }
+
+    // Offsets must increase and record counts must add up
+    uint64_t total = 0;
+    size_t previous = 0;
+    for (uint32_t i = 0; i < blocks; i++) {
+        const char* entry = c->index + i * kContainerIndexEntry;
+        size_t offset = read_le32(entry);
+        if (offset < previous || offset > (size_t)(c->index - data)) {
+            delete c;
+            return nullptr;
+        }
+        previous = offset;
+        c->first_record[i] = (uint32_t)total;
+        total += read_le32(entry + 4);
+    }
+    c->first_record[blocks] = (uint32_t)total;
+    if (total != records) {
+        delete c;
+        return nullptr;
+    }
+    return c;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int snappy_container_record_count(snappy_container* c) {
+    return (int)c->records;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int snappy_container_block_count(snappy_container* c) {
+    return (int)c->blocks;
+}
+
+/**
+ * Fetch record i, decompressing only the block that holds it
+ * @return Record length (data at snappy_container_record), -1 if i is out of
+ *         range, -2 if the block is corrupt
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_container_get(snappy_container* c, int i) {
+    if (i < 0 || (uint32_t)i >= c->records) return -1;
+
+    // Last block whose first record is <= i
+    uint32_t lo = 0, hi = c->blocks;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (c->first_record[mid] <= (uint32_t)i) lo = mid;
+        else hi = mid;
+    }
+    while (c->first_record[lo + 1] <= (uint32_t)i) lo++;  // skip empty entries
+    if (!container_load_block(c, lo)) return -2;
+
+    uint32_t k = (uint32_t)i - c->first_record[lo];
+    uint32_t count = c->first_record[lo + 1] - c->first_record[lo];
+    const char* ends = c->cache.data + c->cache.size - (size_t)count * 4;
+    uint32_t start = k > 0 ? read_le32(ends + (k - 1) * 4) : 0;
+    c->record = c->cache.data + start;
+    return (int)(read_le32(ends + k * 4) - start);
+}
+
+/**
+ * @return Pointer to the record fetched by the last snappy_container_get
+ *         (valid until the next get)
+ */
+EMSCRIPTEN_KEEPALIVE
+const char* snappy_container_record(snappy_container* c) {
+    return c->record;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void snappy_container_free(snappy_container* c) {
+    delete c;
+}
+
+} // extern "C"
+
+// ---------------------------------------------------------------------------
+// Compression levels
+//
+// Level 1 is the classic snappy format encoder; level 2 (snappy 1.2+)
+// searches two hash tables for longer matches, trading compression speed
+// for ratio while decompression speed stays the same. Auto mode compresses
+// the first block at both levels and keeps level 2 only if it saves enough
+// bytes to be worth it and its speed meets a throughput budget. One 64KB
+// block often finishes within a tick of a clamped browser timer, so the
+// speed comes from timing whole level-2 compressions of large inputs, cached
+// for later calls. Inputs under 1MB are cheap at either level and are
+// chosen by ratio only, as are all inputs until a speed has been measured.
+// ---------------------------------------------------------------------------
+
+namespace {
+
+constexpr double kAutoDefaultMinMBps = 100.0;
+constexpr double kAutoMinSaving = 0.03;  // level 2 must save >= 3% vs level 1
+constexpr size_t kAutoRatioOnlyBytes = 1 << 20;  // below this, speed is not checked
+constexpr double kAutoMinTimedMs = 2.0;  // two ticks of a 1ms-clamped timer
+
+// Last level-2 speed the timer could resolve, in MB/s (0 = none yet)
+std::atomic<double> auto_level2_mbps{0.0};
+
+void record_level2_speed(size_t bytes, double ms) {
+    if (ms >= kAutoMinTimedMs) {
+        auto_level2_mbps.store(bytes / 1000.0 / ms, std::memory_order_relaxed);
+    }
+}
+
+int clamp_level(int level) {
+    if (level < snappy::CompressionOptions::MinCompressionLevel()) {
+        return snappy::CompressionOptions::MinCompressionLevel();
+    }
+    if (level > snappy::CompressionOptions::MaxCompressionLevel()) {
+        return snappy::CompressionOptions::MaxCompressionLevel();
+    }
+    return level;
+}
+
+// scratch: MaxCompressedLength(min(input_length, kBlockSize)) bytes
+int pick_level(const char* input, size_t input_length, double min_mbps, char* scratch) {
+    size_t sample = input_length < snappy::kBlockSize ? input_length : snappy::kBlockSize;
+    if (sample == 0) return 1;
+
+    size_t sizes[2];
+    snappy::RawCompress(input, sample, scratch, &sizes[0], snappy::CompressionOptions(1));
+    double start = emscripten_get_now();
+    snappy::RawCompress(input, sample, scratch, &sizes[1], snappy::CompressionOptions(2));
+    // Only a slow level 2 shows up on a clamped timer this early
+    record_level2_speed(sample, emscripten_get_now() - start);
+
+    bool worth_it = sizes[1] <= sizes[0] - (size_t)(sizes[0] * kAutoMinSaving);
+    if (!worth_it) return 1;
+    if (input_length < kAutoRatioOnlyBytes) return 2;
+    double mbps = auto_level2_mbps.load(std::memory_order_relaxed);
+    return mbps == 0 || mbps >= min_mbps ? 2 : 1;
+}
+
+} // namespace
+
+extern "C" {
+
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_level_min() {
+    return snappy::CompressionOptions::MinCompressionLevel();
+}
+
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_level_max() {
+    return snappy::CompressionOptions::MaxCompressionLevel();
+}
+
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_level_default() {
+    return snappy::CompressionOptions::DefaultCompressionLevel();
+}
+
+/**
+ * Pick a level for input by compressing its first 64KB at levels 1 and 2
+ * (inputs of 1MB or more are also checked against the level-2 speed
+ * measured by earlier auto-level compressions, once there is one)
+ * @param input Input data
+ * @param input_length Length of input
+ * @param min_mbps Slowest acceptable level-2 compression speed (MB/s)
+ * @return 1 or 2
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_pick_level(const char* input, size_t input_length, double min_mbps) {
+    size_t sample = input_length < snappy::kBlockSize ? input_length : snappy::kBlockSize;
+    char* scratch = static_cast<char*>(malloc(snappy::MaxCompressedLength(sample)));
+    if (!scratch) return 1;
+    int level = pick_level(input, input_length, min_mbps, scratch);
+    free(scratch);
+    return level;
+}
+
+/**
+ * Compress data at a given level
+ * @param input Input data
+ * @param input_length Length of input
+ * @param output Pre-allocated output buffer
+ * @param output_length Pointer to output length (in: capacity, out: actual size)
+ * @param level 1 (fastest) or 2 (better ratio); 0 = auto with a 100 MB/s
+ *              budget (use snappy_wasm_pick_level for another budget)
+ * @return Level used (1 or 2) on success, -2 if the output buffer is too small
+ */
+EMSCRIPTEN_KEEPALIVE
+int snappy_wasm_compress_level(const char* input, size_t input_length,
+                               char* output, size_t* output_length, int level) {
+    if (*output_length < snappy::MaxCompressedLength(input_length)) return -SNAPPY_BUFFER_TOO_SMALL;
+
+    if (level != 0) {
+        level = clamp_level(level);
+        snappy::RawCompress(input, input_length, output, output_length,
+                            snappy::CompressionOptions(level));
+        return level;
+    }
+
+    // The output buffer doubles as scratch for the sample. Timing the real
+    // level-2 compression costs nothing extra and feeds later auto picks.
+    level = pick_level(input, input_length, kAutoDefaultMinMBps, output);
+    double start = emscripten_get_now();
+    snappy::RawCompress(input, input_length, output, output_length,
+                        snappy::CompressionOptions(level));
+    if (level == 2) record_level2_speed(input_length, emscripten_get_now() - start);
+    return level;
+}
+
+} // extern "C"
@@ -2,9 +2,22 @@
  * Snappy WASM Test Suite
  */
 
+import { readFile } from 'node:fs/promises';
+
 const createModule = (await import('./snappy.js')).default;
 const wasm = await createModule();
 
+// If snappy.js/snappy.wasm predate snappy_wasm.cpp, run Tests 1-4 (the
+// snappy-c API the old build still serves), then fail instead of crashing
+// half-way through on the first missing export
+const source = await readFile(new URL(import.meta.url), 'utf8');
+const missing = [...new Set(source.match(/wasm\._\w+/g))]
+    .map(name => name.slice('wasm.'.length))
+    .filter(name => typeof wasm[name] !== 'function');
+if (missing.length > 0) {
+    console.log(`snappy.wasm is stale: missing ${missing.length} exports, only Tests 1-4 will run\n`);
+}
+
 console.log('=== Snappy WASM Tests ===\n');
 console.log('Version:', wasm.UTF8ToString(wasm._snappy_wasm_version()));
 console.log('');
@@ -201,8 +214,668 @@ console.log('--- Test 4: Performance Benchmark ---');
     }
 }
 
-// Test 5: Compare with LZ4 (if we have it)
-console.log('\n--- Test 5: Summary ---');
+if (missing.length > 0) {
+    console.log(`\n=== Stale Build: Tests 5-12 skipped ===\n\nMissing: ${missing.join(', ')}`);
+    console.log('Rebuild snappy.js, snappy-simd.js and snappy-mt.js with the commands in LEARNINGS.md');
+    process.exit(1);
+}
+
+// Test 5: Framing format streaming
+console.log('\n--- Test 5: Framing Format Streaming ---');
+{
+    // ~4MB of log-like records, fed in uneven pieces
+    const lines = [];
+    for (let i = 0; lines.length < 60000; i++) {
+        lines.push(`${new Date(1700000000000 + i * 1000).toISOString()} INFO worker-${i % 16} handled /api/items/${i * 7 % 10007} in ${i % 250}ms`);
+    }
+    const input = new TextEncoder().encode(lines.join('\n'));
+    const inputPtr = copyToWasm(input);
+
+    const enc = wasm._snappy_frame_encoder_create();
+    const pieces = [];
+    const collect = (n) => {
+        if (n < 0) throw new Error(`encoder error ${n}`);
+        pieces.push(readFromWasm(wasm._snappy_frame_encoder_output(enc), n));
+    };
+    const encStart = performance.now();
+    for (let off = 0, k = 1; off < input.length; k = (k * 7919) % 200000 + 1) {
+        const n = Math.min(k, input.length - off);
+        collect(wasm._snappy_frame_encoder_update(enc, inputPtr + off, n));
+        off += n;
+    }
+    collect(wasm._snappy_frame_encoder_end(enc));
+    const encTime = performance.now() - encStart;
+
+    const stream = new Uint8Array(pieces.reduce((sum, p) => sum + p.length, 0));
+    let pos = 0;
+    for (const p of pieces) { stream.set(p, pos); pos += p.length; }
+    const header = String.fromCharCode(...stream.subarray(4, 10));
+    console.log(`Framed: ${input.length} -> ${stream.length} bytes (${(input.length / stream.length).toFixed(2)}x), stream id "${header}"`);
+
+    // Decode in 16KB network-sized pieces
+    const decodeStream = (bytes) => {
+        const dec = wasm._snappy_frame_decoder_create();
+        const streamPtr = copyToWasm(bytes);
+        const out = new Uint8Array(input.length + 1);
+        let outLen = 0;
+        let status = 0;
+        for (let off = 0; off < bytes.length; off += 16384) {
+            const n = wasm._snappy_frame_decoder_update(dec, streamPtr + off, Math.min(16384, bytes.length - off));
+            if (n < 0) { status = n; break; }
+            if (outLen + n > out.length) { status = -1; break; }
+            out.set(new Uint8Array(wasm.HEAPU8.buffer, wasm._snappy_frame_decoder_output(dec), n), outLen);
+            outLen += n;
+        }
+        const boundary = wasm._snappy_frame_decoder_at_boundary(dec);
+        wasm._snappy_frame_decoder_free(dec);
+        wasm._free(streamPtr);
+        return { status, boundary, out: out.subarray(0, outLen) };
+    };
+
+    const decStart = performance.now();
+    const result = decodeStream(stream);
+    const decTime = performance.now() - decStart;
+    const mb = input.length / 1024 / 1024;
+    console.log(`Encode: ${(mb / (encTime / 1000)).toFixed(0)} MB/s, decode (CRC32C verified): ${(mb / (decTime / 1000)).toFixed(0)} MB/s`);
+
+    let same = result.status === 0 && result.boundary === 1 && result.out.length === input.length;
+    for (let i = 0; same && i < input.length; i++) {
+        if (result.out[i] !== input[i]) same = false;
+    }
+    console.log(`Round-trip: ${same ? '✓ OK' : '✗ FAILED'}`);
+
+    const corrupt = stream.slice();
+    corrupt[corrupt.length - 3] ^= 0x01;
+    console.log(`Corrupted chunk: ${decodeStream(corrupt).status === -3 ? '✓ CRC mismatch detected' : '✗ Not detected'}`);
+    const truncated = decodeStream(stream.subarray(0, stream.length - 5));
+    console.log(`Truncated stream: ${truncated.status === 0 && truncated.boundary === 0 ? '✓ Detected mid-chunk' : '✗ Not detected'}`);
+
+    wasm._snappy_frame_encoder_free(enc);
+    wasm._free(inputPtr);
+}
+
+// Test 6: Scatter/gather records
+console.log('\n--- Test 6: Scatter/Gather (iovec) ---');
+{
+    // Records = header + body + trailer, each already in the heap
+    const records = 20000;
+    const header = new TextEncoder().encode('{"v":2,"source":"ingest-eu-1","type":"click",');
+    const trailer = new TextEncoder().encode(',"sig":"a1b2c3d4e5f6"}');
+    const bodies = Array.from({ length: 64 }, (_, i) =>
+        new TextEncoder().encode(`"payload":{"user":${1000 + i},"path":"/products/${i * 37}","ref":"campaign-${i % 5}","ts":${1700000000 + i}}`));
+
+    const headerPtr = copyToWasm(header);
+    const trailerPtr = copyToWasm(trailer);
+    const bodyPtrs = bodies.map(copyToWasm);
+    const maxRecord = header.length + trailer.length + Math.max(...bodies.map(b => b.length));
+    const maxLen = wasm._snappy_wasm_max_compressed_length(maxRecord);
+    const outputPtr = wasm._malloc(maxLen);
+    const outputLenPtr = wasm._malloc(8);
+    const stagingPtr = wasm._malloc(maxRecord);
+    const iovPtr = wasm._malloc(3 * 8);
+
+    const setIov = (i, ptr, len) => {
+        wasm.setValue(iovPtr + i * 8, ptr, 'i32');
+        wasm.setValue(iovPtr + i * 8 + 4, len, 'i32');
+    };
+
+    // Baseline: stage the pieces into one buffer, then compress
+    let stagedBytes = 0;
+    const stageStart = performance.now();
+    for (let r = 0; r < records; r++) {
+        const body = bodies[r % bodies.length];
+        wasm.HEAPU8.copyWithin(stagingPtr, headerPtr, headerPtr + header.length);
+        wasm.HEAPU8.copyWithin(stagingPtr + header.length, bodyPtrs[r % bodies.length], bodyPtrs[r % bodies.length] + body.length);
+        wasm.HEAPU8.copyWithin(stagingPtr + header.length + body.length, trailerPtr, trailerPtr + trailer.length);
+        const len = header.length + body.length + trailer.length;
+        wasm.setValue(outputLenPtr, maxLen, 'i32');
+        wasm._snappy_wasm_compress(stagingPtr, len, outputPtr, outputLenPtr);
+        stagedBytes += wasm.getValue(outputLenPtr, 'i32');
+    }
+    const stageTime = performance.now() - stageStart;
+
+    // iovec: compress straight from the three segments
+    let iovBytes = 0;
+    const iovStart = performance.now();
+    for (let r = 0; r < records; r++) {
+        const b = r % bodies.length;
+        setIov(0, headerPtr, header.length);
+        setIov(1, bodyPtrs[b], bodies[b].length);
+        setIov(2, trailerPtr, trailer.length);
+        wasm.setValue(outputLenPtr, maxLen, 'i32');
+        wasm._snappy_wasm_compress_iov(iovPtr, 3, outputPtr, outputLenPtr);
+        iovBytes += wasm.getValue(outputLenPtr, 'i32');
+    }
+    const iovTime = performance.now() - iovStart;
+
+    console.log(`${records} records, staged copy: ${stageTime.toFixed(1)}ms, iovec: ${iovTime.toFixed(1)}ms`);
+    console.log(`Same output size: ${stagedBytes === iovBytes ? '✓ OK' : '✗ FAILED'} (${iovBytes} bytes)`);
+
+    // Decompress the last record back into three separate segments
+    const compressedLen = wasm.getValue(outputLenPtr, 'i32');
+    const lastBody = bodies[(records - 1) % bodies.length];
+    const outPtrs = [header.length, lastBody.length, trailer.length].map(n => wasm._malloc(n));
+    setIov(0, outPtrs[0], header.length);
+    setIov(1, outPtrs[1], lastBody.length);
+    setIov(2, outPtrs[2], trailer.length);
+    const uncompResult = wasm._snappy_wasm_uncompress_iov(outputPtr, compressedLen, iovPtr, 3);
+    const matches = [header, lastBody, trailer].every((piece, i) =>
+        readFromWasm(outPtrs[i], piece.length).every((v, j) => v === piece[j]));
+    console.log(`Uncompress into segments: ${uncompResult === 0 && matches ? '✓ OK' : '✗ FAILED'}`);
+
+    setIov(2, outPtrs[2], trailer.length - 1);
+    const shortResult = wasm._snappy_wasm_uncompress_iov(outputPtr, compressedLen, iovPtr, 3);
+    console.log(`Segments too small: ${shortResult === 2 ? '✓ Rejected' : '✗ Should fail'}`);
+
+    [headerPtr, trailerPtr, ...bodyPtrs, ...outPtrs, outputPtr, outputLenPtr, stagingPtr, iovPtr].forEach(p => wasm._free(p));
+}
+
+// Test 7: Single-call decompression
+console.log('\n--- Test 7: Single-Call Decompression ---');
+{
+    // Mix of message sizes, compressed once up front
+    const messages = [];
+    for (let i = 0; i < 2000; i++) {
+        const size = 1024 << (i % 6); // 1KB..32KB
+        const data = new Uint8Array(size);
+        for (let j = 0; j < size; j++) data[j] = 32 + ((j * (i % 7 + 1)) % 90);
+        const inputPtr = copyToWasm(data);
+        const maxLen = wasm._snappy_wasm_max_compressed_length(size);
+        const outputPtr = wasm._malloc(maxLen);
+        const outputLenPtr = wasm._malloc(8);
+        wasm.setValue(outputLenPtr, maxLen, 'i32');
+        wasm._snappy_wasm_compress(inputPtr, size, outputPtr, outputLenPtr);
+        messages.push({ ptr: outputPtr, len: wasm.getValue(outputLenPtr, 'i32'), size, first: data[1], last: data[size - 1] });
+        wasm._free(inputPtr);
+        wasm._free(outputLenPtr);
+    }
+    const totalMB = messages.reduce((sum, m) => sum + m.size, 0) / 1024 / 1024;
+    const rounds = 5;
+
+    // Baseline: length pre-pass, JS-managed allocation, copy out
+    const lenPtr = wasm._malloc(8);
+    let checksum = 0;
+    const baseStart = performance.now();
+    for (let r = 0; r < rounds; r++) {
+        for (const m of messages) {
+            wasm._snappy_wasm_uncompressed_length(m.ptr, m.len, lenPtr);
+            const len = wasm.getValue(lenPtr, 'i32');
+            const outPtr = wasm._malloc(len);
+            wasm.setValue(lenPtr, len, 'i32');
+            wasm._snappy_wasm_uncompress(m.ptr, m.len, outPtr, lenPtr);
+            const copy = readFromWasm(outPtr, len);
+            checksum += copy[len - 1];
+            wasm._free(outPtr);
+        }
+    }
+    const baseTime = performance.now() - baseStart;
+
+    // Growable buffer: one call, view the result in place
+    const buffer = wasm._snappy_buffer_create();
+    let bufferOk = true;
+    const bufferStart = performance.now();
+    for (let r = 0; r < rounds; r++) {
+        for (const m of messages) {
+            const len = wasm._snappy_wasm_uncompress_to_buffer(buffer, m.ptr, m.len);
+            const view = new Uint8Array(wasm.HEAPU8.buffer, wasm._snappy_buffer_data(buffer), len);
+            if (len !== m.size || view[1] !== m.first || view[len - 1] !== m.last) bufferOk = false;
+        }
+    }
+    const bufferTime = performance.now() - bufferStart;
+
+    // Caller region: one call into a preallocated pool
+    const poolSize = 64 * 1024;
+    const poolPtr = wasm._malloc(poolSize);
+    let intoOk = true;
+    const intoStart = performance.now();
+    for (let r = 0; r < rounds; r++) {
+        for (const m of messages) {
+            const len = wasm._snappy_wasm_uncompress_into(m.ptr, m.len, poolPtr, poolSize);
+            if (len !== m.size || wasm.HEAPU8[poolPtr + len - 1] !== m.last) intoOk = false;
+        }
+    }
+    const intoTime = performance.now() - intoStart;
+
+    const rate = (t) => (totalMB * rounds / (t / 1000)).toFixed(0).padStart(5);
+    console.log(`Length call + malloc + copy: ${baseTime.toFixed(1).padStart(7)}ms  ${rate(baseTime)} MB/s`);
+    console.log(`Growable buffer (1 call):    ${bufferTime.toFixed(1).padStart(7)}ms  ${rate(bufferTime)} MB/s  ${(baseTime / bufferTime).toFixed(2)}x`);
+    console.log(`Caller region (1 call):      ${intoTime.toFixed(1).padStart(7)}ms  ${rate(intoTime)} MB/s  ${(baseTime / intoTime).toFixed(2)}x`);
+    console.log(`Single-call results: ${bufferOk && intoOk && checksum > 0 ? '✓ OK' : '✗ FAILED'}`);
+
+    const smallPtr = wasm._malloc(16);
+    const tooSmall = wasm._snappy_wasm_uncompress_into(messages[0].ptr, messages[0].len, smallPtr, 16);
+    const invalid = wasm._snappy_wasm_uncompress_to_buffer(buffer, messages[0].ptr, 1);
+    console.log(`Region too small / invalid input: ${tooSmall === -2 && invalid === -1 ? '✓ Rejected' : '✗ Should fail'}`);
+
+    wasm._snappy_buffer_free(buffer);
+    [lenPtr, poolPtr, smallPtr, ...messages.map(m => m.ptr)].forEach(p => wasm._free(p));
+}
+
+// Test 8: Reusable compressor + batch
+console.log('\n--- Test 8: Reusable Compressor + Batch (1-8KB messages) ---');
+{
+    const count = 20000;
+    const table = new Int32Array(count * 2);
+    let total = 0;
+    for (let i = 0; i < count; i++) {
+        table[i * 2] = total;
+        table[i * 2 + 1] = 1024 + (i * 2654435761 % 7169); // 1KB..8KB
+        total += table[i * 2 + 1];
+    }
+    const input = new Uint8Array(total);
+    const words = ['event', 'user', 'session', 'click', 'view', 'id', 'timestamp', 'value', ':', ',', '{', '}'];
+    for (let i = 0, w = 0; i < total; w++) {
+        const word = words[(w * 7 + (w >> 3)) % words.length];
+        for (let j = 0; j < word.length && i < total; j++) input[i++] = word.charCodeAt(j);
+    }
+    const inputPtr = copyToWasm(input);
+    const tablePtr = copyToWasm(new Uint8Array(table.buffer));
+    const maxMessage = wasm._snappy_wasm_max_compressed_length(8192);
+    const outputPtr = wasm._malloc(maxMessage);
+    const outputLenPtr = wasm._malloc(8);
+    const mb = total / 1024 / 1024;
+
+    // One snappy_compress per message (allocates working memory each time)
+    const perCallSizes = new Int32Array(count);
+    const perCallStart = performance.now();
+    for (let i = 0; i < count; i++) {
+        wasm.setValue(outputLenPtr, maxMessage, 'i32');
+        wasm._snappy_wasm_compress(inputPtr + table[i * 2], table[i * 2 + 1], outputPtr, outputLenPtr);
+        perCallSizes[i] = wasm.getValue(outputLenPtr, 'i32');
+    }
+    const perCallTime = performance.now() - perCallStart;
+
+    // Same loop on a compressor handle
+    const compressor = wasm._snappy_compressor_create();
+    let handleOk = true;
+    const handleStart = performance.now();
+    for (let i = 0; i < count; i++) {
+        wasm.setValue(outputLenPtr, maxMessage, 'i32');
+        wasm._snappy_compressor_compress(compressor, inputPtr + table[i * 2], table[i * 2 + 1], outputPtr, outputLenPtr);
+        if (wasm.getValue(outputLenPtr, 'i32') !== perCallSizes[i]) handleOk = false;
+    }
+    const handleTime = performance.now() - handleStart;
+
+    // One batch call
+    const batchCapacity = wasm._snappy_wasm_max_compressed_batch_length(tablePtr, count);
+    const batchPtr = wasm._malloc(batchCapacity);
+    const outTablePtr = wasm._malloc(count * 8);
+    const batchStart = performance.now();
+    const batchTotal = wasm._snappy_compressor_compress_batch(compressor, inputPtr, tablePtr, count,
+                                                              batchPtr, batchCapacity, outTablePtr);
+    const batchTime = performance.now() - batchStart;
+
+    // Batch output must be byte-identical to snappy_compress
+    const outTable = new Int32Array(wasm.HEAPU8.buffer.slice(outTablePtr, outTablePtr + count * 8));
+    let batchOk = batchTotal > 0;
+    for (let i = 0; batchOk && i < count; i += 997) {
+        wasm.setValue(outputLenPtr, maxMessage, 'i32');
+        wasm._snappy_wasm_compress(inputPtr + table[i * 2], table[i * 2 + 1], outputPtr, outputLenPtr);
+        const expected = readFromWasm(outputPtr, perCallSizes[i]);
+        const actual = readFromWasm(batchPtr + outTable[i * 2], outTable[i * 2 + 1]);
+        batchOk = expected.length === actual.length && expected.every((v, j) => v === actual[j]);
+    }
+
+    const rate = (t) => `${(count / (t / 1000) / 1000).toFixed(0).padStart(5)}k msg/s  ${(mb / (t / 1000)).toFixed(0).padStart(5)} MB/s`;
+    console.log(`${count} messages, ${mb.toFixed(1)}MB`);
+    console.log(`snappy_compress per message: ${perCallTime.toFixed(1).padStart(7)}ms  ${rate(perCallTime)}`);
+    console.log(`Compressor handle:           ${handleTime.toFixed(1).padStart(7)}ms  ${rate(handleTime)}  ${(perCallTime / handleTime).toFixed(2)}x`);
+    console.log(`Batch (1 call):              ${batchTime.toFixed(1).padStart(7)}ms  ${rate(batchTime)}  ${(perCallTime / batchTime).toFixed(2)}x`);
+    console.log(`Identical output: ${handleOk && batchOk ? '✓ OK' : '✗ FAILED'}`);
+
+    // The handle re-implements RawCompress on snappy-internal.h, so check it
+    // against the library at both levels, around the 64KB fragment boundary,
+    // on compressible and random data
+    const sizes = [0, 1, 15, 16, 17, 4095, 65535, 65536, 65537, 131072 + 3, 300000];
+    const maxSize = sizes[sizes.length - 1];
+    const random = new Uint8Array(maxSize);
+    for (let i = 0, x = 1; i < maxSize; i++) {
+        x = (x * 1103515245 + 12345) >>> 0;
+        random[i] = x >>> 24;
+    }
+    const parityInputPtr = wasm._malloc(maxSize);
+    const parityMax = wasm._snappy_wasm_max_compressed_length(maxSize);
+    const expectedPtr = wasm._malloc(parityMax);
+    const actualPtr = wasm._malloc(parityMax);
+    let parityOk = true;
+    let parityCases = 0;
+    for (const data of [input.subarray(0, maxSize), random]) {
+        wasm.HEAPU8.set(data, parityInputPtr);
+        for (const level of [1, 2]) {
+            wasm._snappy_compressor_set_level(compressor, level);
+            for (const size of sizes) {
+                wasm.setValue(outputLenPtr, parityMax, 'i32');
+                wasm._snappy_wasm_compress_level(parityInputPtr, size, expectedPtr, outputLenPtr, level);
+                const expected = readFromWasm(expectedPtr, wasm.getValue(outputLenPtr, 'i32'));
+                wasm.setValue(outputLenPtr, parityMax, 'i32');
+                const status = wasm._snappy_compressor_compress(compressor, parityInputPtr, size, actualPtr, outputLenPtr);
+                const actual = readFromWasm(actualPtr, wasm.getValue(outputLenPtr, 'i32'));
+                parityOk = parityOk && status === 0 && expected.length === actual.length &&
+                           expected.every((v, j) => v === actual[j]);
+                parityCases++;
+            }
+        }
+    }
+    console.log(`Matches RawCompress (levels 1-2, ${parityCases} cases): ${parityOk ? '✓ OK' : '✗ FAILED'}`);
+    // A handle that drifts from the library would silently change the wire
+    // format, so this fails the run rather than just printing
+    if (!(handleOk && batchOk && parityOk)) process.exitCode = 1;
+
+    wasm._snappy_compressor_free(compressor);
+    [parityInputPtr, expectedPtr, actualPtr].forEach(p => wasm._free(p));
+    [inputPtr, tablePtr, outputPtr, outputLenPtr, batchPtr, outTablePtr].forEach(p => wasm._free(p));
+}
+
+// Test 9: SIMD build vs scalar build
+console.log('\n--- Test 9: SIMD128 Build ---');
+{
+    const { default: loadSnappy, simdSupported } = await import('./snappy-loader.mjs');
+    const scalar = await loadSnappy({ simd: false });
+    const simd = await loadSnappy({ simd: true });
+    const haveSimd = simd._snappy_wasm_simd() === 1;
+    console.log(`Engine SIMD support: ${simdSupported}, SIMD build loaded: ${haveSimd}${haveSimd ? '' : ' (snappy-simd.js not built, see LEARNINGS.md)'}`);
+
+    const size = 4 * 1024 * 1024;
+    const text = new TextEncoder().encode(
+        Array.from({ length: 60000 }, (_, i) => `Line ${i}: the quick brown fox jumps over the lazy dog ${i % 97}`).join('\n')).subarray(0, size);
+    const json = new TextEncoder().encode(JSON.stringify(
+        Array.from({ length: 40000 }, (_, i) => ({ id: i, name: `user_${i % 500}`, active: i % 3 === 0, score: (i * 37) % 1000, tags: ['a', 'b', `t${i % 13}`] })))).subarray(0, size);
+    // Binary: little-endian sensor records (slowly varying ints + noise bytes)
+    const binary = new Uint8Array(size);
+    const view = new DataView(binary.buffer);
+    for (let i = 0; i + 16 <= size; i += 16) {
+        view.setUint32(i, i >> 4, true);
+        view.setUint32(i + 4, 1700000000 + (i >> 10), true);
+        view.setFloat32(i + 8, Math.sin(i / 4096), true);
+        view.setUint32(i + 12, (i * 2654435761) >>> 24, true);
+    }
+
+    const bench = (mod, data) => {
+        const inputPtr = mod._malloc(data.length);
+        mod.HEAPU8.set(data, inputPtr);
+        const maxLen = mod._snappy_wasm_max_compressed_length(data.length);
+        const outputPtr = mod._malloc(maxLen);
+        const lenPtr = mod._malloc(8);
+        const decompPtr = mod._malloc(data.length);
+        const iterations = 10;
+
+        const compStart = performance.now();
+        for (let i = 0; i < iterations; i++) {
+            mod.setValue(lenPtr, maxLen, 'i32');
+            mod._snappy_wasm_compress(inputPtr, data.length, outputPtr, lenPtr);
+        }
+        const compTime = performance.now() - compStart;
+        const compressedLen = mod.getValue(lenPtr, 'i32');
+        const compressed = new Uint8Array(mod.HEAPU8.buffer, outputPtr, compressedLen).slice();
+
+        const decompStart = performance.now();
+        for (let i = 0; i < iterations; i++) {
+            mod._snappy_wasm_uncompress_into(outputPtr, compressedLen, decompPtr, data.length);
+        }
+        const decompTime = performance.now() - decompStart;
+
+        [inputPtr, outputPtr, lenPtr, decompPtr].forEach(p => mod._free(p));
+        const mb = data.length * iterations / 1024 / 1024;
+        return { comp: mb / (compTime / 1000), decomp: mb / (decompTime / 1000), compressed };
+    };
+
+    // The builds must be interchangeable: SIMD output decodes with scalar
+    const crossDecode = (compressed, original) => {
+        const inPtr = scalar._malloc(compressed.length);
+        scalar.HEAPU8.set(compressed, inPtr);
+        const outPtr = scalar._malloc(original.length);
+        const n = scalar._snappy_wasm_uncompress_into(inPtr, compressed.length, outPtr, original.length);
+        let ok = n === original.length;
+        for (let i = 0; ok && i < n; i += 4093) ok = scalar.HEAPU8[outPtr + i] === original[i];
+        scalar._free(inPtr);
+        scalar._free(outPtr);
+        return ok;
+    };
+
+    console.log('Corpus    Ratio   Compress scalar/simd MB/s   Decompress scalar/simd MB/s');
+    let crossOk = true;
+    for (const [name, data] of [['Text', text], ['JSON', json], ['Binary', binary]]) {
+        const a = bench(scalar, data);
+        const b = bench(simd, data);
+        // SSSE3/simd128 only changes how snappy copies on decode, so the
+        // compressed bytes must not change either
+        crossOk = crossOk && crossDecode(b.compressed, data) &&
+                  a.compressed.length === b.compressed.length && a.compressed.every((v, i) => v === b.compressed[i]);
+        console.log(`${name.padEnd(8)} ${(data.length / a.compressed.length).toFixed(2).padStart(5)}x   ` +
+                    `${a.comp.toFixed(0).padStart(6)} / ${b.comp.toFixed(0).padEnd(6)} ${(b.comp / a.comp).toFixed(2)}x        ` +
+                    `${a.decomp.toFixed(0).padStart(6)} / ${b.decomp.toFixed(0).padEnd(6)} ${(b.decomp / a.decomp).toFixed(2)}x`);
+    }
+    // Without snappy-simd.js both sides are the scalar build, which leaves
+    // the SIMD build untested: on an engine with SIMD that fails the suite
+    const simdMissing = simdSupported && !haveSimd;
+    console.log(`SIMD output identical and decodes with scalar build: ` +
+                `${simdMissing ? '✗ FAILED (snappy-simd.js not built)' : !haveSimd ? 'not run (engine lacks SIMD)' : crossOk ? '✓ OK' : '✗ FAILED'}`);
+    if (simdMissing || (haveSimd && !crossOk)) process.exitCode = 1;
+}
+
+// Test 10: Parallel framed compression (pthreads build: snappy-mt.js)
+console.log('\n--- Test 10: Parallel Framed Compression ---');
+{
+    let mt = null;
+    try {
+        mt = await (await import('./snappy-mt.js')).default();
+    } catch {
+        console.log('snappy-mt.js not built (see LEARNINGS.md), using single-threaded module');
+    }
+    const pm = mt || wasm;
+
+    const size = 64 * 1024 * 1024;
+    const pattern = new TextEncoder().encode(
+        Array.from({ length: 5000 }, (_, i) => `{"row":${i},"sku":"SKU-${(i * 7919) % 100000}","qty":${i % 40},"region":"r${i % 9}"}`).join('\n'));
+    const inputPtr = pm._malloc(size);
+    for (let off = 0; off < size; off += pattern.length) {
+        pm.HEAPU8.set(pattern.subarray(0, Math.min(pattern.length, size - off)), inputPtr + off);
+    }
+    const bound = pm._snappy_frame_parallel_bound(size);
+    const outputPtr = pm._malloc(bound);
+    const mb = size / 1024 / 1024;
+
+    let baseTime = 0;
+    let streamSize = 0;
+    for (const threads of [1, 2, 4, 8]) {
+        pm._snappy_frame_compress_parallel(inputPtr, size, outputPtr, bound, threads);
+        const start = performance.now();
+        streamSize = pm._snappy_frame_compress_parallel(inputPtr, size, outputPtr, bound, threads);
+        const time = performance.now() - start;
+        if (threads === 1) baseTime = time;
+        console.log(`${threads} thread(s): ${time.toFixed(1).padStart(8)}ms  ${(mb / (time / 1000)).toFixed(0).padStart(6)} MB/s  ${(baseTime / time).toFixed(2)}x  (${streamSize} bytes)`);
+    }
+
+    // Output is a regular framed stream: the streaming decoder must accept it
+    const dec = pm._snappy_frame_decoder_create();
+    let decoded = 0;
+    let ok = streamSize > 0;
+    for (let off = 0; ok && off < streamSize; off += 1024 * 1024) {
+        const n = pm._snappy_frame_decoder_update(dec, outputPtr + off, Math.min(1024 * 1024, streamSize - off));
+        if (n < 0) ok = false;
+        const outPtr = pm._snappy_frame_decoder_output(dec);
+        for (let i = 0; ok && i < n; i += 4099) {
+            if (pm.HEAPU8[outPtr + i] !== pm.HEAPU8[inputPtr + decoded + i]) ok = false;
+        }
+        decoded += Math.max(n, 0);
+    }
+    ok = ok && decoded === size && pm._snappy_frame_decoder_at_boundary(dec) === 1;
+    console.log(`Parallel stream decodes (CRC32C verified): ${ok ? '✓ OK' : '✗ FAILED'}`);
+
+    pm._snappy_frame_decoder_free(dec);
+    pm._free(inputPtr);
+    pm._free(outputPtr);
+}
+
+// Test 11: Block-indexed record container
+console.log('\n--- Test 11: Record Container (point lookups) ---');
+{
+    const count = 50000;
+    const records = Array.from({ length: count }, (_, i) => new TextEncoder().encode(
+        JSON.stringify({ id: i, user: `u${i % 977}`, event: ['view', 'click', 'buy'][i % 3], amount: (i * 31) % 500, note: 'x'.repeat(i % 120) })));
+    const scratchPtr = wasm._malloc(4096);
+
+    const buildContainer = (blockSize) => {
+        const builder = wasm._snappy_container_builder_create(blockSize);
+        for (const record of records) {
+            wasm.HEAPU8.set(record, scratchPtr);
+            wasm._snappy_container_add(builder, scratchPtr, record.length);
+        }
+        const size = wasm._snappy_container_finish(builder);
+        const data = readFromWasm(wasm._snappy_container_builder_output(builder), size);
+        wasm._snappy_container_builder_free(builder);
+        return data;
+    };
+
+    // Baseline: all records in one snappy buffer
+    const totalLength = records.reduce((sum, r) => sum + r.length, 0);
+    const wholePtr = wasm._malloc(totalLength);
+    const offsets = new Int32Array(count + 1);
+    for (let i = 0; i < count; i++) {
+        wasm.HEAPU8.set(records[i], wholePtr + offsets[i]);
+        offsets[i + 1] = offsets[i] + records[i].length;
+    }
+    const wholeMax = wasm._snappy_wasm_max_compressed_length(totalLength);
+    const wholeCompPtr = wasm._malloc(wholeMax);
+    const lenPtr = wasm._malloc(8);
+    wasm.setValue(lenPtr, wholeMax, 'i32');
+    wasm._snappy_wasm_compress(wholePtr, totalLength, wholeCompPtr, lenPtr);
+    const wholeSize = wasm.getValue(lenPtr, 'i32');
+
+    const lookups = 2000;
+    const targets = Array.from({ length: lookups }, (_, i) => (i * 104729) % count);
+
+    const wholeStart = performance.now();
+    for (const i of targets) {
+        wasm._snappy_wasm_uncompress_into(wholeCompPtr, wholeSize, wholePtr, totalLength);
+        new Uint8Array(wasm.HEAPU8.buffer, wholePtr + offsets[i], records[i].length);
+    }
+    const wholeTime = performance.now() - wholeStart;
+    console.log(`Whole object (${totalLength} -> ${wholeSize} bytes): ${(wholeTime / lookups * 1000).toFixed(1)}µs per lookup`);
+
+    let ok = true;
+    for (const blockSize of [4096, 16384, 65536]) {
+        const container = buildContainer(blockSize);
+        const containerPtr = copyToWasm(container);
+        const handle = wasm._snappy_container_open(containerPtr, container.length);
+
+        const start = performance.now();
+        for (const i of targets) {
+            const len = wasm._snappy_container_get(handle, i);
+            const record = new Uint8Array(wasm.HEAPU8.buffer, wasm._snappy_container_record(handle), len);
+            if (len !== records[i].length || record[len - 1] !== records[i][len - 1]) ok = false;
+        }
+        const time = performance.now() - start;
+
+        const blocks = wasm._snappy_container_block_count(handle);
+        ok = ok && wasm._snappy_container_record_count(handle) === count;
+        console.log(`${(blockSize / 1024).toString().padStart(2)}KB blocks (${blocks} blocks, ${container.length} bytes): ` +
+                    `${(time / lookups * 1000).toFixed(1)}µs per lookup, ${(wholeTime / time).toFixed(0)}x faster`);
+
+        wasm._snappy_container_free(handle);
+        wasm._free(containerPtr);
+    }
+
+    // Full check on one container, plus bounds
+    const container = buildContainer(16384);
+    const containerPtr = copyToWasm(container);
+    const handle = wasm._snappy_container_open(containerPtr, container.length);
+    for (let i = 0; ok && i < count; i++) {
+        const len = wasm._snappy_container_get(handle, i);
+        const record = readFromWasm(wasm._snappy_container_record(handle), len);
+        ok = len === records[i].length && record.every((v, j) => v === records[i][j]);
+    }
+    console.log(`All records intact: ${ok ? '✓ OK' : '✗ FAILED'}`);
+
+    // A builder reused after finish starts the next container from scratch
+    const reused = wasm._snappy_container_builder_create(16384);
+    for (const pass of [0, 1]) {
+        for (const record of records.slice(pass * 1000, pass * 1000 + 1000)) {
+            wasm.HEAPU8.set(record, scratchPtr);
+            wasm._snappy_container_add(reused, scratchPtr, record.length);
+        }
+        const size = wasm._snappy_container_finish(reused);
+        const again = wasm._snappy_container_open(wasm._snappy_container_builder_output(reused), size);
+        const len = wasm._snappy_container_get(again, 999);
+        const last = readFromWasm(wasm._snappy_container_record(again), len);
+        ok = ok && wasm._snappy_container_record_count(again) === 1000 && len === records[pass * 1000 + 999].length &&
+             last.every((v, j) => v === records[pass * 1000 + 999][j]);
+        wasm._snappy_container_free(again);
+    }
+    wasm._snappy_container_builder_free(reused);
+    console.log(`Builder reuse after finish: ${ok ? '✓ OK' : '✗ FAILED'}`);
+    console.log(`Out of range: ${wasm._snappy_container_get(handle, count) === -1 ? '✓ Rejected' : '✗ Should fail'}`);
+    wasm.HEAPU8[containerPtr + container.length - 1] ^= 0xFF;
+    console.log(`Bad footer: ${wasm._snappy_container_open(containerPtr, container.length) === 0 ? '✓ Rejected' : '✗ Should fail'}`);
+
+    wasm._snappy_container_free(handle);
+    [containerPtr, scratchPtr, wholePtr, wholeCompPtr, lenPtr].forEach(p => wasm._free(p));
+}
+
+// Test 12: Compression levels + auto picker
+console.log('\n--- Test 12: Compression Levels ---');
+{
+    const size = 2 * 1024 * 1024;
+    const text = new TextEncoder().encode(
+        Array.from({ length: 40000 }, (_, i) => `Chapter ${i % 40}: it was the ${['best', 'worst', 'age', 'epoch'][i % 4]} of times, line ${i}`).join('\n')).subarray(0, size);
+    const json = new TextEncoder().encode(JSON.stringify(
+        Array.from({ length: 25000 }, (_, i) => ({ order: i, customer: `c${(i * 13) % 2000}`, items: i % 5 + 1, total: ((i * 7) % 10000) / 100, status: ['new', 'paid', 'shipped'][i % 3] })))).subarray(0, size);
+    const binary = new Uint8Array(size);
+    for (let i = 0; i < size; i++) binary[i] = (i & 0xF0) ^ ((i * 2654435761) >>> 28);
+
+    const inputPtr = wasm._malloc(size);
+    const maxLen = wasm._snappy_wasm_max_compressed_length(size);
+    const outputPtr = wasm._malloc(maxLen);
+    const lenPtr = wasm._malloc(8);
+    const decompPtr = wasm._malloc(size);
+    const minLevel = wasm._snappy_wasm_level_min();
+    const maxLevel = wasm._snappy_wasm_level_max();
+    let ok = true;
+
+    console.log(`Levels ${minLevel}-${maxLevel} (default ${wasm._snappy_wasm_level_default()})`);
+    console.log('Corpus   Level   Ratio   Compress MB/s   Decompress MB/s');
+    for (const [name, data] of [['Text', text], ['JSON', json], ['Binary', binary]]) {
+        wasm.HEAPU8.set(data, inputPtr);
+        for (let level = minLevel; level <= maxLevel; level++) {
+            const iterations = 10;
+            let used = 0;
+            const compStart = performance.now();
+            for (let i = 0; i < iterations; i++) {
+                wasm.setValue(lenPtr, maxLen, 'i32');
+                used = wasm._snappy_wasm_compress_level(inputPtr, data.length, outputPtr, lenPtr, level);
+            }
+            const compTime = performance.now() - compStart;
+            const compressedLen = wasm.getValue(lenPtr, 'i32');
+
+            const decompStart = performance.now();
+            for (let i = 0; i < iterations; i++) {
+                wasm._snappy_wasm_uncompress_into(outputPtr, compressedLen, decompPtr, data.length);
+            }
+            const decompTime = performance.now() - decompStart;
+            ok = ok && used === level && wasm.HEAPU8[decompPtr + data.length - 1] === data[data.length - 1];
+
+            const mb = data.length * iterations / 1024 / 1024;
+            console.log(`${name.padEnd(8)} ${String(level).padStart(5)}   ${(data.length / compressedLen).toFixed(2).padStart(5)}x   ` +
+                        `${(mb / (compTime / 1000)).toFixed(0).padStart(13)}   ${(mb / (decompTime / 1000)).toFixed(0).padStart(15)}`);
+        }
+
+        // Auto picker at different CPU budgets (the level-0 call first, so
+        // the picks can use the level-2 speed it measured)
+        wasm.setValue(lenPtr, maxLen, 'i32');
+        const autoLevel = wasm._snappy_wasm_compress_level(inputPtr, data.length, outputPtr, lenPtr, 0);
+        const pickStart = performance.now();
+        const picks = [50, 150, 400, 1000].map(budget => `${budget}MB/s->L${wasm._snappy_wasm_pick_level(inputPtr, data.length, budget)}`);
+        const pickMs = (performance.now() - pickStart) / 4;
+        console.log(`${''.padEnd(8)} auto: ${picks.join(', ')}; level 0 used L${autoLevel}; ${pickMs.toFixed(3)}ms per pick`);
+        ok = ok && (autoLevel === 1 || autoLevel === 2);
+    }
+    console.log(`Levels round-trip: ${ok ? '✓ OK' : '✗ FAILED'}`);
+
+    [inputPtr, outputPtr, lenPtr, decompPtr].forEach(p => wasm._free(p));
+}
+
+// Test 13: Compare with LZ4 (if we have it)
+console.log('\n--- Test 13: Summary ---');
 console.log('Snappy characteristics:');
 console.log('- Very fast compression and decompression');
 console.log('- Moderate compression ratios');
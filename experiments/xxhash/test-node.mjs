@@ -2,9 +2,22 @@
  * xxHash WASM Test Suite
  */
 
+import { readFile } from 'node:fs/promises';
+
 const createModule = (await import('./xxhash.js')).default;
 const wasm = await createModule();
 
+// If xxhash.js/xxhash.wasm predate xxhash_wasm.c, run Tests 1-8 (the
+// one-shot and streaming API the old build still serves), then fail instead
+// of crashing half-way through on the first missing export
+const source = await readFile(new URL(import.meta.url), 'utf8');
+const missing = [...new Set(source.match(/wasm\._\w+/g))]
+    .map(name => name.slice('wasm.'.length))
+    .filter(name => typeof wasm[name] !== 'function');
+if (missing.length > 0) {
+    console.log(`xxhash.wasm is stale: missing ${missing.length} exports, only Tests 1-8 will run\n`);
+}
+
 console.log('=== xxHash WASM Tests ===\n');
 console.log('Version:', wasm.UTF8ToString(wasm._xxhash_version()));
 console.log('');
@@ -244,4 +257,499 @@ console.log('\n--- Test 8: Compare with JS Hash ---');
     wasm._free(ptr);
 }
 
+if (missing.length > 0) {
+    console.log(`\n=== Stale Build: Tests 9-15 skipped ===\n\nMissing: ${missing.join(', ')}`);
+    console.log('Rebuild xxhash.js, xxhash-simd.js and xxhash-mt.js with the commands in LEARNINGS.md');
+    process.exit(1);
+}
+
+// Test 9: Concurrent streaming sessions
+console.log('\n--- Test 9: Concurrent Streaming Sessions ---');
+{
+    const KIND_NAMES = ['XXH32', 'XXH64', 'XXH3-64', 'XXH3-128'];
+    const uploads = 64;
+    const uploadSize = 256 * 1024;
+    const chunkSize = 16 * 1024;
+    const digestPtr = wasm._malloc(16);
+
+    const readDigest = (words) => {
+        let hex = '';
+        for (let i = words - 1; i >= 0; i--) hex += wasm.HEAPU32[(digestPtr >> 2) + i].toString(16).padStart(8, '0');
+        return hex;
+    };
+
+    // One-shot reference digests, same word order as xxh_session_digest
+    const oneShot = (kind, ptr, len) => {
+        if (kind === 0) return (wasm._xxhash32(ptr, len, 7) >>> 0).toString(16).padStart(8, '0');
+        if (kind === 1) return read64BitHex(wasm._xxhash64_split(ptr, len, 7, 0));
+        if (kind === 2) return read64BitHex(wasm._xxh3_64_withSeed(ptr, len, 7, 0));
+        return null; // XXH3-128 has no seeded one-shot export: checked unseeded below
+    };
+
+    // Interleave chunks of many uploads, as a worker would see them arrive
+    const dataPtrs = [];
+    const sessions = [];
+    for (let u = 0; u < uploads; u++) {
+        const data = new Uint8Array(uploadSize);
+        for (let i = 0; i < uploadSize; i++) data[i] = (i * (u + 3) + (i >> 9)) & 0xFF;
+        dataPtrs.push(copyToWasm(data));
+        const kind = u % 4;
+        sessions.push(wasm._xxh_session_create(kind, kind === 3 ? 0 : 7, 0));
+    }
+    for (let off = 0; off < uploadSize; off += chunkSize) {
+        for (let u = 0; u < uploads; u++) {
+            wasm._xxh_session_update(sessions[u], dataPtrs[u] + off, chunkSize);
+        }
+    }
+
+    let ok = true;
+    for (let u = 0; u < uploads; u++) {
+        const kind = u % 4;
+        const words = wasm._xxh_session_digest(sessions[u], digestPtr);
+        const digest = readDigest(words);
+        const expected = kind === 3 ? read128BitHex(wasm._xxh3_128(dataPtrs[u], uploadSize)) : oneShot(kind, dataPtrs[u], uploadSize);
+        if (digest !== expected) {
+            ok = false;
+            console.log(`✗ upload ${u} (${KIND_NAMES[kind]}): ${digest} != ${expected}`);
+        }
+        wasm._xxh_session_free(sessions[u]);
+    }
+    console.log(`${uploads} interleaved uploads (${KIND_NAMES.join(', ')}): ${ok ? '✓ all match one-shot' : '✗ mismatch'}`);
+    console.log(`Pool capacity after ${uploads} live sessions: ${wasm._xxh_session_pool_capacity()}`);
+
+    // Session churn: small uploads, one session each
+    const churn = 100000;
+    const smallPtr = dataPtrs[0];
+    const legacyStart = performance.now();
+    for (let i = 0; i < churn; i++) {
+        wasm._xxh3_streaming_init();
+        wasm._xxh3_streaming_update(smallPtr, 512);
+        wasm._xxh3_streaming_digest();
+    }
+    wasm._xxh3_streaming_free();
+    const legacyTime = performance.now() - legacyStart;
+
+    const capacityBefore = wasm._xxh_session_pool_capacity();
+    const sessionStart = performance.now();
+    for (let i = 0; i < churn; i++) {
+        const session = wasm._xxh_session_create(2, 0, 0);
+        wasm._xxh_session_update(session, smallPtr, 512);
+        wasm._xxh_session_digest(session, digestPtr);
+        wasm._xxh_session_free(session);
+    }
+    const sessionTime = performance.now() - sessionStart;
+    const grew = wasm._xxh_session_pool_capacity() !== capacityBefore;
+
+    console.log(`${churn} x (create, 512B update, digest, free): legacy ${legacyTime.toFixed(1)}ms, pooled sessions ${sessionTime.toFixed(1)}ms`);
+    console.log(`Pool reused without growth: ${grew ? '✗ FAILED' : '✓ OK'}`);
+
+    dataPtrs.forEach(p => wasm._free(p));
+    wasm._free(digestPtr);
+}
+
+// Test 10: Batch hashing (10k small files)
+console.log('\n--- Test 10: Batch Hashing (10k small files) ---');
+{
+    const count = 10000;
+    const files = [];
+    let total = 0;
+    for (let i = 0; i < count; i++) {
+        const size = 64 + (i * 2654435761 % 4033); // 64B..4KB
+        const file = new Uint8Array(size);
+        for (let j = 0; j < size; j++) file[j] = (j * 131 + i) & 0xFF;
+        files.push(file);
+        total += size;
+    }
+
+    // Per file: copy in, hash, read the static result
+    const perFileHashes = new Array(count);
+    const perFileStart = performance.now();
+    for (let i = 0; i < count; i++) {
+        const ptr = copyToWasm(files[i]);
+        perFileHashes[i] = read64BitHex(wasm._xxh3_64(ptr, files[i].length));
+        wasm._free(ptr);
+    }
+    const perFileTime = performance.now() - perFileStart;
+
+    // Batch: pack once, one call, digests land in an output array
+    const batchStart = performance.now();
+    const basePtr = wasm._malloc(total);
+    const tablePtr = wasm._malloc(count * 8);
+    const outPtr = wasm._malloc(count * 16);
+    let offset = 0;
+    for (let i = 0; i < count; i++) {
+        wasm.HEAPU8.set(files[i], basePtr + offset);
+        wasm.HEAPU32[(tablePtr >> 2) + i * 2] = offset;
+        wasm.HEAPU32[(tablePtr >> 2) + i * 2 + 1] = files[i].length;
+        offset += files[i].length;
+    }
+    wasm._xxh3_64_batch(basePtr, tablePtr, count, outPtr);
+    const digests = new Uint32Array(wasm.HEAPU8.buffer, outPtr, count * 2).slice();
+    const batchTime = performance.now() - batchStart;
+
+    const hashStart = performance.now();
+    wasm._xxh3_64_batch(basePtr, tablePtr, count, outPtr);
+    const hashOnlyTime = performance.now() - hashStart;
+
+    let ok = true;
+    for (let i = 0; ok && i < count; i++) {
+        const hex = (BigInt(digests[i * 2 + 1]) << 32n | BigInt(digests[i * 2])).toString(16).padStart(16, '0');
+        ok = hex === perFileHashes[i];
+    }
+
+    // XXH3-128 batch against the one-shot export
+    wasm._xxh3_128_batch(basePtr, tablePtr, count, outPtr);
+    for (let i = 0; ok && i < count; i += 101) {
+        const o = (outPtr >> 2) + i * 4;
+        const w = wasm.HEAPU32;
+        const batchHex = (BigInt(w[o + 3]) << 32n | BigInt(w[o + 2])).toString(16).padStart(16, '0') +
+                         (BigInt(w[o + 1]) << 32n | BigInt(w[o])).toString(16).padStart(16, '0');
+        ok = batchHex === read128BitHex(wasm._xxh3_128(basePtr + wasm.HEAPU32[(tablePtr >> 2) + i * 2], files[i].length));
+    }
+
+    const mb = total / 1024 / 1024;
+    console.log(`${count} files, ${mb.toFixed(1)}MB`);
+    console.log(`Per-file calls:        ${perFileTime.toFixed(2).padStart(8)}ms  (${(perFileTime / count * 1000).toFixed(2)}µs/file)`);
+    console.log(`Batch incl. packing:   ${batchTime.toFixed(2).padStart(8)}ms  (${(perFileTime / batchTime).toFixed(1)}x)`);
+    console.log(`Batch hash call only:  ${hashOnlyTime.toFixed(2).padStart(8)}ms  (${(mb / (hashOnlyTime / 1000)).toFixed(0)} MB/s)`);
+    console.log(`Batch digests match one-shot (64 + 128): ${ok ? '✓ OK' : '✗ FAILED'}`);
+
+    [basePtr, tablePtr, outPtr].forEach(p => wasm._free(p));
+}
+
+// Test 11: Reentrant results (caller-provided output)
+console.log('\n--- Test 11: Reentrant Results ---');
+{
+    const data = stringToBytes('The quick brown fox jumps over the lazy dog');
+    const ptr = copyToWasm(data);
+    const out = wasm._malloc(32);
+    const w = () => wasm.HEAPU32;
+    const hex64 = (p) => (BigInt(w()[(p >> 2) + 1]) << 32n | BigInt(w()[p >> 2])).toString(16).padStart(16, '0');
+
+    // Each variant must match its static-array counterpart
+    const checks = [];
+    wasm._xxhash64_split_into(ptr, data.length, 42, 7, out);
+    checks.push(['xxhash64_split_into', hex64(out), read64BitHex(wasm._xxhash64_split(ptr, data.length, 42, 7))]);
+    wasm._xxh3_64_into(ptr, data.length, out);
+    checks.push(['xxh3_64_into', hex64(out), read64BitHex(wasm._xxh3_64(ptr, data.length))]);
+    wasm._xxh3_64_withSeed_into(ptr, data.length, 42, 7, out);
+    checks.push(['xxh3_64_withSeed_into', hex64(out), read64BitHex(wasm._xxh3_64_withSeed(ptr, data.length, 42, 7))]);
+    wasm._xxh3_128_into(ptr, data.length, out);
+    checks.push(['xxh3_128_into', hex64(out + 8) + hex64(out), read128BitHex(wasm._xxh3_128(ptr, data.length))]);
+    wasm._xxh3_streaming_init();
+    wasm._xxh3_streaming_update(ptr, data.length);
+    wasm._xxh3_streaming_digest_into(out);
+    checks.push(['xxh3_streaming_digest_into', hex64(out), read64BitHex(wasm._xxh3_streaming_digest())]);
+    wasm._xxh3_streaming_free();
+    for (const [name, got, want] of checks) {
+        console.log(`${name.padEnd(28)} ${got === want ? '✓ OK' : '✗ FAILED'}`);
+    }
+
+    // Results survive later calls: two digests side by side in one buffer
+    wasm._xxh3_64_into(ptr, data.length, out);
+    wasm._xxh3_64_into(ptr, 9, out + 8);
+    wasm._xxh3_64(ptr, 3);  // clobbers only the static array
+    console.log(`Earlier results untouched by later calls: ${hex64(out) === checks[1][2] && hex64(out + 8) === read64BitHex(wasm._xxh3_64(ptr, 9)) ? '✓ OK' : '✗ FAILED'}`);
+
+    // The build commands pass -sWASM_BIGINT; without it the i64 return is
+    // legalized and JS only sees the low 32 bits as a Number
+    const big = wasm._xxh3_64_u64(ptr, data.length);
+    const bigOk = typeof big === 'bigint' && BigInt.asUintN(64, big).toString(16).padStart(16, '0') === checks[1][2];
+    console.log(`xxh3_64_u64 (BigInt):        ${bigOk ? '✓ OK' : `✗ FAILED${typeof big === 'bigint' ? '' : ' (built without -sWASM_BIGINT)'}`}`);
+
+    // Per-file loop: static array + copy out vs digests written in place
+    const count = 10000;
+    const fileSize = 256;
+    const filePtr = wasm._malloc(fileSize);
+    wasm.HEAPU8.fill(0xAB, filePtr, filePtr + fileSize);
+    const results = wasm._malloc(count * 8);
+
+    const staticStart = performance.now();
+    const copied = new Uint32Array(count * 2);
+    for (let i = 0; i < count; i++) {
+        const r = wasm._xxh3_64(filePtr, fileSize - (i & 63)) >> 2;
+        copied[i * 2] = wasm.HEAPU32[r];
+        copied[i * 2 + 1] = wasm.HEAPU32[r + 1];
+    }
+    const staticTime = performance.now() - staticStart;
+
+    const intoStart = performance.now();
+    for (let i = 0; i < count; i++) {
+        wasm._xxh3_64_into(filePtr, fileSize - (i & 63), results + i * 8);
+    }
+    const intoTime = performance.now() - intoStart;
+
+    const inPlace = new Uint32Array(wasm.HEAPU8.buffer, results, count * 2);
+    const same = copied.every((v, i) => v === inPlace[i]);
+    console.log(`${count} files: static + copy ${staticTime.toFixed(2)}ms, in place ${intoTime.toFixed(2)}ms, digests ${same ? 'match ✓' : 'differ ✗'}`);
+
+    [ptr, out, filePtr, results].forEach(p => wasm._free(p));
+}
+
+// Test 12: Parallel tree hashing (pthreads build: xxhash-mt.js)
+console.log('\n--- Test 12: Parallel Tree Hashing ---');
+{
+    let mt = null;
+    try {
+        mt = await (await import('./xxhash-mt.js')).default();
+    } catch {
+        console.log('xxhash-mt.js not built (see LEARNINGS.md), using single-threaded module');
+    }
+    const hm = mt || wasm;
+    const hex128 = (w, o) =>
+        (BigInt(w[o + 3]) << 32n | BigInt(w[o + 2])).toString(16).padStart(16, '0') +
+        (BigInt(w[o + 1]) << 32n | BigInt(w[o])).toString(16).padStart(16, '0');
+
+    const size = 128 * 1024 * 1024;
+    const leafSize = 1024 * 1024;
+    const dataPtr = hm._malloc(size);
+    for (let off = 0; off < size; off += 4) {
+        hm.HEAPU32[(dataPtr + off) >> 2] = Math.imul(off, 2654435761);
+    }
+    const leaves = hm._xxh3_tree_leaf_count(size, leafSize);
+    const rootPtr = hm._malloc(16);
+    const leafPtr = hm._malloc(leaves * 16);
+    const mb = size / 1024 / 1024;
+
+    // Serial baseline: XXH3-128 streaming session fed 1MB at a time
+    const session = hm._xxh_session_create(3, 0, 0);
+    const serialStart = performance.now();
+    for (let off = 0; off < size; off += leafSize) {
+        hm._xxh_session_update(session, dataPtr + off, Math.min(leafSize, size - off));
+    }
+    hm._xxh_session_digest(session, rootPtr);
+    const serialTime = performance.now() - serialStart;
+    hm._xxh_session_free(session);
+    console.log(`Serial streaming XXH3-128: ${serialTime.toFixed(2).padStart(8)}ms  (${(mb / (serialTime / 1000)).toFixed(0)} MB/s)`);
+
+    let root = null;
+    let rootsMatch = true;
+    for (const threads of [1, 2, 4, 8]) {
+        const start = performance.now();
+        hm._xxh3_tree_hash(dataPtr, size, leafSize, threads, rootPtr, leafPtr);
+        const time = performance.now() - start;
+        const digest = hex128(hm.HEAPU32, rootPtr >> 2);
+        if (root === null) root = digest;
+        rootsMatch = rootsMatch && digest === root;
+        console.log(`Tree, ${threads} thread(s):       ${time.toFixed(2).padStart(8)}ms  (${(mb / (time / 1000)).toFixed(0)} MB/s, ${(serialTime / time).toFixed(2)}x)`);
+    }
+    console.log(`${leaves} leaves, root ${root}`);
+    console.log(`Root independent of thread count: ${rootsMatch ? '✓ OK' : '✗ FAILED'}`);
+
+    // Leaf digests are plain XXH3-128 of their range (partial verification)
+    let leavesOk = true;
+    for (const i of [0, 17, leaves - 1]) {
+        const want = hex128(hm.HEAPU32, hm._xxh3_128(dataPtr + i * leafSize, leafSize) >> 2);
+        leavesOk = leavesOk && hex128(hm.HEAPU32, (leafPtr >> 2) + i * 4) === want;
+    }
+    console.log(`Leaf digests match XXH3-128 of their range: ${leavesOk ? '✓ OK' : '✗ FAILED'}`);
+
+    // Leaf-aligned windows combined with xxh3_tree_root give the same root
+    const half = (leaves >> 1) * leafSize;
+    hm._xxh3_tree_hash(dataPtr, half, leafSize, 2, rootPtr, leafPtr);
+    hm._xxh3_tree_hash(dataPtr + half, size - half, leafSize, 2, rootPtr, leafPtr + (leaves >> 1) * 16);
+    hm._xxh3_tree_root(leafPtr, leaves, size >>> 0, Math.floor(size / 2 ** 32), rootPtr);
+    console.log(`Windowed hashing gives the same root: ${hex128(hm.HEAPU32, rootPtr >> 2) === root ? '✓ OK' : '✗ FAILED'}`);
+
+    [dataPtr, rootPtr, leafPtr].forEach(p => hm._free(p));
+}
+
+// Test 13: Content-defined chunking (FastCDC + XXH3-128)
+console.log('\n--- Test 13: Content-Defined Chunking ---');
+{
+    const size = 64 * 1024 * 1024;
+    const window = 1024 * 1024;
+    const dataPtr = wasm._malloc(size + 16);
+    let x = 0x2545F491;
+    for (let off = 0; off < size; off += 4) {
+        x ^= x << 13; x ^= x >>> 17; x ^= x << 5;
+        wasm.HEAPU32[(dataPtr + off) >> 2] = x >>> 0;
+    }
+    const mb = size / 1024 / 1024;
+
+    // Chunk and hash the stream in 1MB updates, collecting [length, 4-word digest]
+    const chunkStream = (ptr, length) => {
+        const cdc = wasm._xxh_cdc_create(2048, 8192, 65536);
+        const chunks = [];
+        const collect = (n) => {
+            const base = wasm._xxh_cdc_chunks(cdc) >> 2;
+            for (let i = 0; i < n; i++) chunks.push(Array.from(wasm.HEAPU32.subarray(base + i * 5, base + i * 5 + 5)));
+        };
+        for (let off = 0; off < length; off += window) {
+            collect(wasm._xxh_cdc_update(cdc, ptr + off, Math.min(window, length - off)));
+        }
+        collect(wasm._xxh_cdc_final(cdc));
+        wasm._xxh_cdc_free(cdc);
+        return chunks;
+    };
+
+    const cdcStart = performance.now();
+    const chunks = chunkStream(dataPtr, size);
+    const cdcTime = performance.now() - cdcStart;
+
+    const rawStart = performance.now();
+    wasm._xxh3_128(dataPtr, size);
+    const rawTime = performance.now() - rawStart;
+
+    let covered = 0;
+    let digestsOk = true;
+    const sizes = chunks.map(c => c[0]);
+    for (let i = 0; i < chunks.length; i++) {
+        if (i % 97 === 0) {
+            const w = wasm.HEAPU32;
+            const o = wasm._xxh3_128(dataPtr + covered, chunks[i][0]) >> 2;
+            digestsOk = digestsOk && [1, 2, 3, 4].every(k => chunks[i][k] === w[o + k - 1]);
+        }
+        covered += chunks[i][0];
+    }
+    console.log(`${chunks.length} chunks, avg ${(size / chunks.length).toFixed(0)}B, min ${Math.min(...sizes.slice(0, -1))}B, max ${Math.max(...sizes)}B`);
+    console.log(`Chunks cover the input exactly: ${covered === size ? '✓ OK' : '✗ FAILED'}`);
+    console.log(`Chunk digests match XXH3-128 of their range: ${digestsOk ? '✓ OK' : '✗ FAILED'}`);
+    console.log(`Raw XXH3-128:      ${rawTime.toFixed(2).padStart(8)}ms  (${(mb / (rawTime / 1000)).toFixed(0)} MB/s)`);
+    console.log(`Chunk + hash:      ${cdcTime.toFixed(2).padStart(8)}ms  (${(mb / (cdcTime / 1000)).toFixed(0)} MB/s, ${(cdcTime / rawTime).toFixed(2)}x raw)`);
+
+    // Insert 16 bytes near the start: only the chunks around the edit change
+    wasm.HEAPU8.copyWithin(dataPtr + 1016, dataPtr + 1000, dataPtr + size);
+    wasm.HEAPU8.fill(0x5A, dataPtr + 1000, dataPtr + 1016);
+    const edited = chunkStream(dataPtr, size + 16);
+    const known = new Set(chunks.map(c => c.join(',')));
+    const shared = edited.filter(c => known.has(c.join(','))).length;
+    console.log(`After a 16-byte insertion: ${shared}/${edited.length} chunks unchanged ${edited.length - shared <= 3 ? '✓ OK' : '✗ FAILED'}`);
+
+    wasm._free(dataPtr);
+}
+
+// Test 14: SIMD128 XXH3 kernel vs scalar build
+console.log('\n--- Test 14: SIMD128 XXH3 Kernel ---');
+{
+    const { default: loadXXHash, simdSupported } = await import('./xxhash-loader.mjs');
+    const scalar = await loadXXHash({ simd: false });
+    const simd = await loadXXHash({ simd: true });
+    const haveSimd = simd._xxhash_simd() === 1;
+    console.log(`Engine SIMD support: ${simdSupported}, SIMD build loaded: ${haveSimd}${haveSimd ? '' : ' (xxhash-simd.js not built, see LEARNINGS.md)'}`);
+
+    const maxSize = 64 * 1024 * 1024;
+    const source = new Uint8Array(maxSize + 64);
+    let x = 0x9E3779B9;
+    for (let i = 0; i < source.length; i++) {
+        x ^= x << 13; x ^= x >>> 17; x ^= x << 5;
+        source[i] = x & 0xFF;
+    }
+    const scalarPtr = scalar._malloc(source.length);
+    const simdPtr = simd._malloc(source.length);
+    scalar.HEAPU8.set(source, scalarPtr);
+    simd.HEAPU8.set(source, simdPtr);
+    const outScalar = scalar._malloc(16);
+    const outSimd = simd._malloc(16);
+    const same128 = () => {
+        const a = scalar.HEAPU32.subarray(outScalar >> 2, (outScalar >> 2) + 4);
+        const b = simd.HEAPU32.subarray(outSimd >> 2, (outSimd >> 2) + 4);
+        return a.every((v, i) => v === b[i]);
+    };
+
+    // Bit-exactness: every length around the 240-byte long-input cutoff and
+    // stripe/block edges, unaligned offsets, then sparse sizes up to 64MB
+    const lengths = [];
+    for (let len = 0; len <= 2048; len++) lengths.push(len);
+    for (let len = 2049; len < maxSize; len = Math.floor(len * 1.7) + 13) lengths.push(len);
+    lengths.push(maxSize);
+    let exact = true;
+    for (const len of lengths) {
+        const off = len % 7;
+        scalar._xxh3_64_into(scalarPtr + off, len, outScalar);
+        simd._xxh3_64_into(simdPtr + off, len, outSimd);
+        const ok64 = scalar.HEAPU32[outScalar >> 2] === simd.HEAPU32[outSimd >> 2] &&
+                     scalar.HEAPU32[(outScalar >> 2) + 1] === simd.HEAPU32[(outSimd >> 2) + 1];
+        scalar._xxh3_128_into(scalarPtr + off, len, outScalar);
+        simd._xxh3_128_into(simdPtr + off, len, outSimd);
+        if (!ok64 || !same128()) {
+            console.log(`  Mismatch at length ${len}`);
+            exact = false;
+            break;
+        }
+    }
+    // Without xxhash-simd.js the loader hands back the scalar build, and a
+    // scalar-vs-scalar match proves nothing about the kernel. On an engine
+    // with SIMD that means the kernel is untested, which fails the suite.
+    const simdMissing = simdSupported && !haveSimd;
+    console.log(`Bit-exact with scalar over ${lengths.length} lengths (64 + 128): ` +
+                `${simdMissing ? '✗ FAILED (xxhash-simd.js not built)' : !haveSimd ? 'not run (engine lacks SIMD)' : exact ? '✓ OK' : '✗ FAILED'}`);
+    if (simdMissing || (haveSimd && !exact)) process.exitCode = 1;
+
+    // Throughput 64B..64MB
+    console.log('\nSize        Scalar MB/s   SIMD MB/s   Speedup');
+    for (let size = 64; size <= maxSize; size *= 16) {
+        const iterations = Math.max(3, Math.floor(256 * 1024 * 1024 / size / 4));
+        const time = (mod, ptr, out) => {
+            const start = performance.now();
+            for (let i = 0; i < iterations; i++) mod._xxh3_64_into(ptr, size, out);
+            return performance.now() - start;
+        };
+        const scalarTime = time(scalar, scalarPtr, outScalar);
+        const simdTime = time(simd, simdPtr, outSimd);
+        const mbps = (t) => (size * iterations / 1024 / 1024 / (t / 1000)).toFixed(0);
+        const label = size >= 1024 * 1024 ? `${size / 1024 / 1024}MB` : size >= 1024 ? `${size / 1024}KB` : `${size}B`;
+        console.log(`${label.padEnd(10)}  ${mbps(scalarTime).padStart(10)}  ${mbps(simdTime).padStart(10)}  ${(scalarTime / simdTime).toFixed(2).padStart(7)}x`);
+    }
+
+    scalar._free(scalarPtr); scalar._free(outScalar);
+    simd._free(simdPtr); simd._free(outSimd);
+}
+
+// Test 15: Checkpoint a session and resume it in another module instance
+console.log('\n--- Test 15: Resumable Streaming State ---');
+{
+    const other = await createModule();  // stands in for a different isolate
+    const blobSize = wasm._xxh_session_blob_size();
+    const upload = new Uint8Array(3 * 1024 * 1024 + 7);
+    for (let i = 0; i < upload.length; i++) upload[i] = (i * 31 + (i >> 11)) & 0xFF;
+    const part = 1024 * 1024 + 333;  // bytes received before failover
+    const hex = (mod, p, words) => Array.from(mod.HEAPU32.subarray(p >> 2, (p >> 2) + words))
+        .map(w => w.toString(16).padStart(8, '0')).reverse().join('');
+
+    for (const [kind, name] of [[2, 'XXH3-64'], [3, 'XXH3-128']]) {
+        const words = kind === 2 ? 2 : 4;
+
+        // First instance hashes the received prefix and checkpoints it
+        const first = wasm._xxh_session_create(kind, 99, 0);
+        const prefixPtr = copyToWasm(upload.subarray(0, part));
+        wasm._xxh_session_update(first, prefixPtr, part);
+        const blobPtr = wasm._malloc(blobSize);
+        wasm._xxh_session_export(first, blobPtr);
+        const blob = new Uint8Array(wasm.HEAPU8.buffer, blobPtr, blobSize).slice();  // to KV
+        wasm._xxh_session_free(first);
+        wasm._free(prefixPtr);
+        wasm._free(blobPtr);
+
+        // Second instance resumes from the blob and hashes only the rest
+        const otherBlob = other._malloc(blobSize);
+        other.HEAPU8.set(blob, otherBlob);
+        const resumed = other._xxh_session_import(otherBlob, blobSize);
+        const restPtr = other._malloc(upload.length - part);
+        other.HEAPU8.set(upload.subarray(part), restPtr);
+        other._xxh_session_update(resumed, restPtr, upload.length - part);
+        const outPtr = other._malloc(16);
+        other._xxh_session_digest(resumed, outPtr);
+        const got = hex(other, outPtr, words);
+
+        // Reference: the whole upload in one session
+        const whole = wasm._xxh_session_create(kind, 99, 0);
+        const wholePtr = copyToWasm(upload);
+        wasm._xxh_session_update(whole, wholePtr, upload.length);
+        const refPtr = wasm._malloc(16);
+        wasm._xxh_session_digest(whole, refPtr);
+        const want = hex(wasm, refPtr, words);
+        console.log(`${name.padEnd(8)} resumed after ${part} bytes (${blobSize}B blob): ${got === want ? '✓ OK' : '✗ FAILED'}`);
+
+        // A corrupted checkpoint is rejected rather than producing a wrong hash
+        other.HEAPU8[otherBlob + 120] ^= 0x01;
+        console.log(`${name.padEnd(8)} corrupted blob rejected: ${other._xxh_session_import(otherBlob, blobSize) === 0 ? '✓ OK' : '✗ FAILED'}`);
+
+        other._xxh_session_free(resumed);
+        [otherBlob, restPtr, outPtr].forEach(p => other._free(p));
+        wasm._xxh_session_free(whole);
+        [wholePtr, refPtr].forEach(p => wasm._free(p));
+    }
+}
+
 console.log('\n=== All Tests Complete ===');
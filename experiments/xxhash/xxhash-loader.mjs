@@ -0,0 +1,19 @@
+/**
+ * xxHash WASM loader
+ * Picks the simd128 build (xxhash-simd.js) when the engine supports WASM
+ * SIMD, and the scalar build (xxhash.js) otherwise
+ */
+
+import { simdSupported, loadVariant } from '../simd-loader.mjs';
+
+export { simdSupported };
+
+/**
+ * Instantiate xxHash
+ * @param {{simd?: boolean}} options Force a build (defaults to feature detection)
+ * @returns Emscripten module; module._xxhash_simd() tells which build loaded
+ */
+export default function loadXXHash({ simd = simdSupported } = {}) {
+    return loadVariant(new URL('./xxhash-simd.js', import.meta.url),
+                       new URL('./xxhash.js', import.meta.url), simd);
+}
@@ -6,9 +6,120 @@
 #include <emscripten.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <pthread.h>
+#endif
 
 #define XXH_INLINE_ALL
 #include "repo/xxhash.h"
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+// The pointer-returning calls below hand back static result arrays. In a
+// pthreads build those are per thread, so workers never clobber each other;
+// the *_into variants skip them entirely and write into caller memory.
+#ifdef __EMSCRIPTEN_PTHREADS__
+#define XXH_RESULT_STORAGE static _Thread_local
+#else
+#define XXH_RESULT_STORAGE static
+#endif
+
+static inline void xxh_store64(uint32_t* out, uint64_t hash) {
+    out[0] = (uint32_t)(hash & 0xFFFFFFFF);
+    out[1] = (uint32_t)(hash >> 32);
+}
+
+static inline void xxh_store128(uint32_t* out, XXH128_hash_t hash) {
+    out[0] = (uint32_t)(hash.low64 & 0xFFFFFFFF);
+    out[1] = (uint32_t)(hash.low64 >> 32);
+    out[2] = (uint32_t)(hash.high64 & 0xFFFFFFFF);
+    out[3] = (uint32_t)(hash.high64 >> 32);
+}
+
+// SIMD128 XXH3 kernel
+//
+// xxhash.h has no WASM kernel of its own (only NEON through a SIMDe
+// polyfill), so without one XXH3's long-input loop runs scalar. In the
+// -msimd128 build (xxhash-simd.js, see LEARNINGS.md) these replace the
+// stripe accumulate and scramble steps for one-shot XXH3-64/128 inputs
+// over 240 bytes. Shorter inputs don't use the long-input loop and stay
+// scalar, and streaming sessions still use the library kernel. The output
+// is bit-identical to the scalar build.
+#ifdef __wasm_simd128__
+
+XXH_FORCE_INLINE void
+XXH3_accumulate_512_simd128(void* XXH_RESTRICT acc, const void* XXH_RESTRICT input,
+                            const void* XXH_RESTRICT secret) {
+    uint8_t* const xacc = (uint8_t*)acc;  // only 8-byte aligned: use unaligned loads
+    const uint8_t* const xinput = (const uint8_t*)input;
+    const uint8_t* const xsecret = (const uint8_t*)secret;
+    for (size_t i = 0; i < XXH_STRIPE_LEN / sizeof(v128_t); i++) {
+        v128_t const data_vec = wasm_v128_load(xinput + 16 * i);
+        v128_t const key_vec = wasm_v128_load(xsecret + 16 * i);
+        v128_t const data_key = wasm_v128_xor(data_vec, key_vec);
+        // acc[i] += lo32(data_key) * hi32(data_key), one 32x32->64 multiply per lane
+        v128_t const product = wasm_u64x2_extmul_low_u32x4(
+            wasm_i32x4_shuffle(data_key, data_key, 0, 2, 0, 2),
+            wasm_i32x4_shuffle(data_key, data_key, 1, 3, 1, 3));
+        // acc[i ^ 1] += data: swap the two 64-bit lanes
+        v128_t const data_swap = wasm_i64x2_shuffle(data_vec, data_vec, 1, 0);
+        v128_t const sum = wasm_i64x2_add(wasm_v128_load(xacc + 16 * i), data_swap);
+        wasm_v128_store(xacc + 16 * i, wasm_i64x2_add(product, sum));
+    }
+}
+
+XXH_FORCE_INLINE XXH3_ACCUMULATE_TEMPLATE(simd128)
+
+XXH_FORCE_INLINE void
+XXH3_scrambleAcc_simd128(void* XXH_RESTRICT acc, const void* XXH_RESTRICT secret) {
+    uint8_t* const xacc = (uint8_t*)acc;
+    const uint8_t* const xsecret = (const uint8_t*)secret;
+    v128_t const prime32 = wasm_i64x2_splat(XXH_PRIME32_1);
+    for (size_t i = 0; i < XXH_STRIPE_LEN / sizeof(v128_t); i++) {
+        v128_t acc_vec = wasm_v128_load(xacc + 16 * i);
+        acc_vec = wasm_v128_xor(acc_vec, wasm_u64x2_shr(acc_vec, 47));
+        acc_vec = wasm_v128_xor(acc_vec, wasm_v128_load(xsecret + 16 * i));
+        wasm_v128_store(xacc + 16 * i, wasm_i64x2_mul(acc_vec, prime32));
+    }
+}
+
+XXH_NO_INLINE XXH64_hash_t
+xxh3_hashLong_64b_simd128(const void* XXH_RESTRICT input, size_t len,
+                          XXH64_hash_t seed64, const xxh_u8* XXH_RESTRICT secret, size_t secretLen) {
+    (void)seed64; (void)secret; (void)secretLen;
+    return XXH3_hashLong_64b_internal(input, len, XXH3_kSecret, sizeof(XXH3_kSecret),
+                                      XXH3_accumulate_simd128, XXH3_scrambleAcc_simd128);
+}
+
+XXH_NO_INLINE XXH128_hash_t
+xxh3_hashLong_128b_simd128(const void* XXH_RESTRICT input, size_t len,
+                           XXH64_hash_t seed64, const void* XXH_RESTRICT secret, size_t secretLen) {
+    (void)seed64; (void)secret; (void)secretLen;
+    return XXH3_hashLong_128b_internal(input, len, XXH3_kSecret, sizeof(XXH3_kSecret),
+                                       XXH3_accumulate_simd128, XXH3_scrambleAcc_simd128);
+}
+
+#endif
+
+// One-shot unseeded XXH3, through the SIMD128 kernel when built with it
+static inline XXH64_hash_t xxh3_64_oneshot(const void* data, size_t len) {
+#ifdef __wasm_simd128__
+    return XXH3_64bits_internal(data, len, 0, XXH3_kSecret, sizeof(XXH3_kSecret), xxh3_hashLong_64b_simd128);
+#else
+    return XXH3_64bits(data, len);
+#endif
+}
+
+static inline XXH128_hash_t xxh3_128_oneshot(const void* data, size_t len) {
+#ifdef __wasm_simd128__
+    return XXH3_128bits_internal(data, len, 0, XXH3_kSecret, sizeof(XXH3_kSecret), xxh3_hashLong_128b_simd128);
+#else
+    return XXH3_128bits(data, len);
+#endif
+}
 
 /**
  * Compute 32-bit xxHash
@@ -30,14 +141,12 @@ uint64_t xxhash64(const void* data, size_t len, uint64_t seed) {
  * Compute 64-bit xxHash and return as two 32-bit values (for JS compatibility)
  * Returns pointer to static array [low32, high32]
  */
-static uint32_t xxhash64_result[2];
+XXH_RESULT_STORAGE uint32_t xxhash64_result[2];
 
 EMSCRIPTEN_KEEPALIVE
 uint32_t* xxhash64_split(const void* data, size_t len, uint32_t seed_low, uint32_t seed_high) {
     uint64_t seed = ((uint64_t)seed_high << 32) | seed_low;
-    uint64_t hash = XXH64(data, len, seed);
-    xxhash64_result[0] = (uint32_t)(hash & 0xFFFFFFFF);
-    xxhash64_result[1] = (uint32_t)(hash >> 32);
+    xxh_store64(xxhash64_result, XXH64(data, len, seed));
     return xxhash64_result;
 }
 
@@ -46,9 +155,7 @@ uint32_t* xxhash64_split(const void* data, size_t len, uint32_t seed_low, uint32
  */
 EMSCRIPTEN_KEEPALIVE
 uint32_t* xxh3_64(const void* data, size_t len) {
-    uint64_t hash = XXH3_64bits(data, len);
-    xxhash64_result[0] = (uint32_t)(hash & 0xFFFFFFFF);
-    xxhash64_result[1] = (uint32_t)(hash >> 32);
+    xxh_store64(xxhash64_result, xxh3_64_oneshot(data, len));
     return xxhash64_result;
 }
 
@@ -58,9 +165,7 @@ uint32_t* xxh3_64(const void* data, size_t len) {
 EMSCRIPTEN_KEEPALIVE
 uint32_t* xxh3_64_withSeed(const void* data, size_t len, uint32_t seed_low, uint32_t seed_high) {
     uint64_t seed = ((uint64_t)seed_high << 32) | seed_low;
-    uint64_t hash = XXH3_64bits_withSeed(data, len, seed);
-    xxhash64_result[0] = (uint32_t)(hash & 0xFFFFFFFF);
-    xxhash64_result[1] = (uint32_t)(hash >> 32);
+    xxh_store64(xxhash64_result, XXH3_64bits_withSeed(data, len, seed));
     return xxhash64_result;
 }
 
@@ -68,60 +173,832 @@ uint32_t* xxh3_64_withSeed(const void* data, size_t len, uint32_t seed_low, uint
  * XXH3 128-bit (strongest)
  * Returns pointer to static array [low0, high0, low1, high1]
  */
-static uint32_t xxhash128_result[4];
+XXH_RESULT_STORAGE uint32_t xxhash128_result[4];
 
 EMSCRIPTEN_KEEPALIVE
 uint32_t* xxh3_128(const void* data, size_t len) {
-    XXH128_hash_t hash = XXH3_128bits(data, len);
-    xxhash128_result[0] = (uint32_t)(hash.low64 & 0xFFFFFFFF);
-    xxhash128_result[1] = (uint32_t)(hash.low64 >> 32);
-    xxhash128_result[2] = (uint32_t)(hash.high64 & 0xFFFFFFFF);
-    xxhash128_result[3] = (uint32_t)(hash.high64 >> 32);
+    xxh_store128(xxhash128_result, xxh3_128_oneshot(data, len));
     return xxhash128_result;
 }
 
-// Streaming API for large data
+// Reentrant API
+//
+// Same digests, written to a caller-provided out pointer instead of a
+// shared static array: nothing to copy out before the next call, and safe
+// to call from any number of threads at once. out can point at a reused
+// scratch slot or straight into a results array.
 
-static XXH3_state_t* g_streaming_state = NULL;
+/**
+ * 64-bit xxHash into out ([low32, high32])
+ */
+EMSCRIPTEN_KEEPALIVE
+void xxhash64_split_into(const void* data, size_t len, uint32_t seed_low, uint32_t seed_high, uint32_t* out) {
+    uint64_t seed = ((uint64_t)seed_high << 32) | seed_low;
+    xxh_store64(out, XXH64(data, len, seed));
+}
 
+/**
+ * XXH3 64-bit into out ([low32, high32])
+ */
 EMSCRIPTEN_KEEPALIVE
-int xxh3_streaming_init(void) {
-    if (g_streaming_state) {
-        XXH3_freeState(g_streaming_state);
+void xxh3_64_into(const void* data, size_t len, uint32_t* out) {
+    xxh_store64(out, xxh3_64_oneshot(data, len));
+}
+
+/**
+ * XXH3 64-bit with seed into out ([low32, high32])
+ */
+EMSCRIPTEN_KEEPALIVE
+void xxh3_64_withSeed_into(const void* data, size_t len, uint32_t seed_low, uint32_t seed_high, uint32_t* out) {
+    uint64_t seed = ((uint64_t)seed_high << 32) | seed_low;
+    xxh_store64(out, XXH3_64bits_withSeed(data, len, seed));
+}
+
+/**
+ * XXH3 128-bit into out ([low0, high0, low1, high1])
+ */
+EMSCRIPTEN_KEEPALIVE
+void xxh3_128_into(const void* data, size_t len, uint32_t* out) {
+    xxh_store128(out, xxh3_128_oneshot(data, len));
+}
+
+/**
+ * XXH3 64-bit returned by value as a JS BigInt (no memory round-trip at all).
+ * Needs -sWASM_BIGINT, which the LEARNINGS.md build commands pass; without
+ * it the return is legalized to i32 and JS gets only the low half.
+ */
+EMSCRIPTEN_KEEPALIVE
+uint64_t xxh3_64_u64(const void* data, size_t len) {
+    return xxh3_64_oneshot(data, len);
+}
+
+// Batch API
+//
+// Hashing many small files one call at a time pays a boundary crossing, a
+// copy and a static-array read per file. The batch calls take all files
+// packed into one buffer plus a table of count [offset, length] pairs and
+// write every digest into a caller-provided array in one call.
+
+/**
+ * XXH3 64-bit of count buffers
+ * out: 2 words per entry ([low32, high32])
+ * Returns count
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh3_64_batch(const uint8_t* base, const uint32_t* table, int count, uint32_t* out) {
+    for (int i = 0; i < count; i++) {
+        xxh_store64(out + i * 2, xxh3_64_oneshot(base + table[i * 2], table[i * 2 + 1]));
+    }
+    return count;
+}
+
+/**
+ * XXH3 128-bit of count buffers
+ * out: 4 words per entry ([low0, high0, low1, high1])
+ * Returns count
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh3_128_batch(const uint8_t* base, const uint32_t* table, int count, uint32_t* out) {
+    for (int i = 0; i < count; i++) {
+        xxh_store128(out + i * 4, xxh3_128_oneshot(base + table[i * 2], table[i * 2 + 1]));
+    }
+    return count;
+}
+
+// Tree hashing
+//
+// One XXH3 pass is bounded by a single core. Tree mode splits the input into
+// fixed-size leaves, hashes each leaf with XXH3-128 on a pthread pool
+// (pthreads build, see LEARNINGS.md; otherwise on the calling thread) and
+// hashes the leaf digests into a root:
+//
+//   leaf[i] = XXH3_128(data[i * leaf_size .. +leaf_size])
+//   root    = XXH3_128_withSeed(leaf[0] || ... || leaf[n-1], seed = total length)
+//
+// with each leaf serialized as low64, high64 little-endian (exactly the
+// 4-word layout written to leaf_out). Leaf digests let a receiver verify or
+// re-fetch single ranges. The root differs from a plain XXH3-128 of the data
+// and depends on leaf_size. Inputs too large for linear memory can be hashed
+// in leaf-aligned windows and combined with xxh3_tree_root.
+
+#define XXH_TREE_MAX_THREADS 64
+
+typedef struct {
+    const uint8_t* data;
+    size_t len;
+    size_t leaf_size;
+    size_t leaves;
+    uint32_t* digests;  // 4 words per leaf
+    atomic_size_t next;
+} xxh_tree_job;
+
+static void* xxh_tree_worker(void* arg) {
+    xxh_tree_job* job = (xxh_tree_job*)arg;
+    for (;;) {
+        size_t i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->leaves) break;
+        size_t offset = i * job->leaf_size;
+        size_t n = job->len - offset;
+        if (n > job->leaf_size) n = job->leaf_size;
+        xxh_store128(job->digests + i * 4, xxh3_128_oneshot(job->data + offset, n));
+    }
+    return NULL;
+}
+
+/**
+ * Number of leaves for len bytes (an empty input is one empty leaf)
+ */
+EMSCRIPTEN_KEEPALIVE
+size_t xxh3_tree_leaf_count(size_t len, size_t leaf_size) {
+    if (leaf_size == 0) return 0;
+    return len == 0 ? 1 : (len + leaf_size - 1) / leaf_size;
+}
+
+/**
+ * Combine leaf digests (4 words each) into the root digest
+ * @param len_low, len_high Total input length covered by the leaves
+ * out: [low0, high0, low1, high1]
+ */
+EMSCRIPTEN_KEEPALIVE
+void xxh3_tree_root(const uint32_t* leaf_digests, size_t leaves,
+                    uint32_t len_low, uint32_t len_high, uint32_t* out) {
+    uint64_t total = ((uint64_t)len_high << 32) | len_low;
+    xxh_store128(out, XXH3_128bits_withSeed(leaf_digests, leaves * 16, total));
+}
+
+/**
+ * Tree-hash data using up to `threads` threads
+ * @param leaf_size Leaf size in bytes (e.g. 1MB)
+ * @param threads Worker threads (1 = calling thread only)
+ * @param root_out Root digest, 4 words
+ * @param leaf_out Optional (NULL to skip): 4 words per leaf, room for
+ *                 xxh3_tree_leaf_count(len, leaf_size) leaves
+ * Returns number of leaves, -1 if leaf_size is 0, -3 on allocation failure
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh3_tree_hash(const void* data, size_t len, size_t leaf_size, int threads,
+                   uint32_t* root_out, uint32_t* leaf_out) {
+    if (leaf_size == 0) return -1;
+
+    xxh_tree_job job;
+    job.data = (const uint8_t*)data;
+    job.len = len;
+    job.leaf_size = leaf_size;
+    job.leaves = xxh3_tree_leaf_count(len, leaf_size);
+    job.digests = leaf_out ? leaf_out : (uint32_t*)malloc(job.leaves * 16);
+    if (!job.digests) return -3;
+    atomic_init(&job.next, 0);
+
+    if (threads < 1) threads = 1;
+    if (threads > XXH_TREE_MAX_THREADS) threads = XXH_TREE_MAX_THREADS;
+    if ((size_t)threads > job.leaves) threads = (int)job.leaves;
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+    pthread_t workers[XXH_TREE_MAX_THREADS];
+    int started = 0;
+    // The calling thread hashes leaves too, so start one fewer worker
+    while (started < threads - 1 &&
+           pthread_create(&workers[started], NULL, xxh_tree_worker, &job) == 0) {
+        started++;
+    }
+    xxh_tree_worker(&job);
+    for (int t = 0; t < started; t++) pthread_join(workers[t], NULL);
+#else
+    xxh_tree_worker(&job);
+#endif
+
+    xxh3_tree_root(job.digests, job.leaves, (uint32_t)((uint64_t)len & 0xFFFFFFFF),
+                   (uint32_t)((uint64_t)len >> 32), root_out);
+    if (!leaf_out) free(job.digests);
+    return (int)job.leaves;
+}
+
+// Streaming sessions
+//
+// Each session is an opaque handle holding an XXH32, XXH64, XXH3-64 or
+// XXH3-128 state, so any number of hashes can be in flight at once (e.g.
+// concurrent uploads in one worker). Sessions come from a pooled slab:
+// freed sessions go on a free list and are reused, so steady-state churn
+// never calls malloc. The pool only grows (to the peak number of live
+// sessions); in a pthreads build the free list is guarded by a mutex, and a
+// single session must still be used by one thread at a time.
+
+#define XXH_SESSION_32 0
+#define XXH_SESSION_64 1
+#define XXH_SESSION_XXH3_64 2
+#define XXH_SESSION_XXH3_128 3
+
+#define XXH_SESSION_SLAB 32  // sessions allocated per slab
+
+typedef struct xxh_session {
+    union {
+        XXH32_state_t s32;
+        XXH64_state_t s64;
+        XXH3_state_t s3;  // 64-byte aligned, so slabs are too
+    } state;
+    int kind;
+    uint64_t seed;
+    struct xxh_session* next_free;
+} xxh_session;
+
+static xxh_session* g_session_free = NULL;
+static int g_session_capacity = 0;
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+static pthread_mutex_t g_session_lock = PTHREAD_MUTEX_INITIALIZER;
+#define XXH_SESSION_LOCK() pthread_mutex_lock(&g_session_lock)
+#define XXH_SESSION_UNLOCK() pthread_mutex_unlock(&g_session_lock)
+#else
+#define XXH_SESSION_LOCK() ((void)0)
+#define XXH_SESSION_UNLOCK() ((void)0)
+#endif
+
+static xxh_session* xxh_session_alloc(void) {
+    XXH_SESSION_LOCK();
+    if (!g_session_free) {
+        xxh_session* slab = (xxh_session*)aligned_alloc(64, sizeof(xxh_session) * XXH_SESSION_SLAB);
+        if (!slab) {
+            XXH_SESSION_UNLOCK();
+            return NULL;
+        }
+        for (int i = XXH_SESSION_SLAB - 1; i >= 0; i--) {
+            slab[i].next_free = g_session_free;
+            g_session_free = &slab[i];
+        }
+        g_session_capacity += XXH_SESSION_SLAB;
+    }
+    xxh_session* s = g_session_free;
+    g_session_free = s->next_free;
+    XXH_SESSION_UNLOCK();
+    return s;
+}
+
+/**
+ * Restart a session with its kind and seed (no allocation)
+ */
+EMSCRIPTEN_KEEPALIVE
+void xxh_session_reset(xxh_session* s) {
+    switch (s->kind) {
+    case XXH_SESSION_32:
+        XXH32_reset(&s->state.s32, (uint32_t)s->seed);
+        break;
+    case XXH_SESSION_64:
+        XXH64_reset(&s->state.s64, s->seed);
+        break;
+    case XXH_SESSION_XXH3_64:
+        XXH3_64bits_reset_withSeed(&s->state.s3, s->seed);
+        break;
+    default:
+        XXH3_128bits_reset_withSeed(&s->state.s3, s->seed);
+        break;
+    }
+}
+
+/**
+ * Start a streaming hash
+ * @param kind 0 = XXH32, 1 = XXH64, 2 = XXH3-64, 3 = XXH3-128
+ * @param seed_low, seed_high 64-bit seed (XXH32 uses seed_low)
+ * Returns session handle, or NULL if kind is invalid / out of memory
+ */
+EMSCRIPTEN_KEEPALIVE
+xxh_session* xxh_session_create(int kind, uint32_t seed_low, uint32_t seed_high) {
+    if (kind < XXH_SESSION_32 || kind > XXH_SESSION_XXH3_128) return NULL;
+    xxh_session* s = xxh_session_alloc();
+    if (!s) return NULL;
+
+    s->kind = kind;
+    s->seed = ((uint64_t)seed_high << 32) | seed_low;
+    if (kind >= XXH_SESSION_XXH3_64) XXH3_INITSTATE(&s->state.s3);
+    xxh_session_reset(s);
+    return s;
+}
+
+/**
+ * Feed data to a session
+ * Returns 1 on success, 0 on error
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh_session_update(xxh_session* s, const void* data, size_t len) {
+    XXH_errorcode rc;
+    switch (s->kind) {
+    case XXH_SESSION_32:
+        rc = XXH32_update(&s->state.s32, data, len);
+        break;
+    case XXH_SESSION_64:
+        rc = XXH64_update(&s->state.s64, data, len);
+        break;
+    case XXH_SESSION_XXH3_64:
+        rc = XXH3_64bits_update(&s->state.s3, data, len);
+        break;
+    default:
+        rc = XXH3_128bits_update(&s->state.s3, data, len);
+        break;
+    }
+    return rc == XXH_OK;
+}
+
+/**
+ * Write the digest of everything fed so far into out as 32-bit words, low
+ * word first ([lo, hi] for 64-bit, [low64 lo, low64 hi, high64 lo, high64 hi]
+ * for 128-bit). The session can keep receiving data afterwards.
+ * Returns number of words written (1, 2 or 4)
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh_session_digest(xxh_session* s, uint32_t* out) {
+    uint64_t hash;
+    switch (s->kind) {
+    case XXH_SESSION_32:
+        out[0] = XXH32_digest(&s->state.s32);
+        return 1;
+    case XXH_SESSION_64:
+        hash = XXH64_digest(&s->state.s64);
+        break;
+    case XXH_SESSION_XXH3_64:
+        hash = XXH3_64bits_digest(&s->state.s3);
+        break;
+    default:
+        xxh_store128(out, XXH3_128bits_digest(&s->state.s3));
+        return 4;
     }
-    g_streaming_state = XXH3_createState();
-    if (!g_streaming_state) return 0;
-    XXH3_64bits_reset(g_streaming_state);
+    xxh_store64(out, hash);
+    return 2;
+}
+
+/**
+ * Return a session to the pool
+ */
+EMSCRIPTEN_KEEPALIVE
+void xxh_session_free(xxh_session* s) {
+    if (!s) return;
+    XXH_SESSION_LOCK();
+    s->next_free = g_session_free;
+    g_session_free = s;
+    XXH_SESSION_UNLOCK();
+}
+
+/**
+ * Sessions allocated so far (live + pooled); stays at the peak number of
+ * concurrent sessions, rounded up to a slab
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh_session_pool_capacity(void) {
+    return g_session_capacity;
+}
+
+// Session checkpoints
+//
+// An XXH3-64/128 session can be exported to a fixed-size blob and imported
+// into a new session in another module instance, so an upload can resume
+// elsewhere without re-hashing the bytes already received. The blob
+// holds the seed, counters, 8 accumulators and the pending stripe buffer,
+// all little-endian. It does not hold customSecret, which is derived from
+// the seed again on import, or extSecret, which is a pointer. An XXH32
+// checksum at the end rejects blobs that were truncated or corrupted in
+// storage.
+//
+//   0  u32 magic "XH3S"   4 u8 version, u8 kind, u16 0
+//   8  u64 seed          16 u64 totalLen     24 u64 nbStripesSoFar
+//  32  u32 bufferedSize  36 u32 0            40 u64 acc[8]
+// 104  u8 buffer[256]   360 u32 XXH32(bytes 0..359)
+
+#define XXH_SESSION_BLOB_SIZE 364
+#define XXH_SESSION_BLOB_MAGIC 0x53334858U  // "XH3S"
+#define XXH_SESSION_BLOB_VERSION 1
+
+static void xxh_write_le32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * Size of a session checkpoint blob in bytes
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh_session_blob_size(void) {
+    return XXH_SESSION_BLOB_SIZE;
+}
+
+/**
+ * Write an XXH3 session's state to blob (xxh_session_blob_size() bytes).
+ * The session is unchanged and can keep hashing.
+ * Returns bytes written, -1 if the session is not XXH3-64/128
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh_session_export(xxh_session* s, uint8_t* blob) {
+    if (s->kind != XXH_SESSION_XXH3_64 && s->kind != XXH_SESSION_XXH3_128) return -1;
+    const XXH3_state_t* st = &s->state.s3;
+
+    memset(blob, 0, XXH_SESSION_BLOB_SIZE);
+    xxh_write_le32(blob, XXH_SESSION_BLOB_MAGIC);
+    blob[4] = XXH_SESSION_BLOB_VERSION;
+    blob[5] = (uint8_t)s->kind;
+    XXH_writeLE64(blob + 8, s->seed);
+    XXH_writeLE64(blob + 16, st->totalLen);
+    XXH_writeLE64(blob + 24, (uint64_t)st->nbStripesSoFar);
+    xxh_write_le32(blob + 32, st->bufferedSize);
+    for (int i = 0; i < 8; i++) {
+        XXH_writeLE64(blob + 40 + i * 8, st->acc[i]);
+    }
+    memcpy(blob + 104, st->buffer, XXH3_INTERNALBUFFER_SIZE);
+    xxh_write_le32(blob + 360, XXH32(blob, 360, 0));
+    return XXH_SESSION_BLOB_SIZE;
+}
+
+/**
+ * Create a session that continues exactly where an exported one stopped
+ * Returns session handle (free with xxh_session_free), or NULL if the blob
+ * is malformed, corrupted or from another format version
+ */
+EMSCRIPTEN_KEEPALIVE
+xxh_session* xxh_session_import(const uint8_t* blob, size_t size) {
+    if (size < XXH_SESSION_BLOB_SIZE) return NULL;
+    if (XXH_readLE32(blob) != XXH_SESSION_BLOB_MAGIC || blob[4] != XXH_SESSION_BLOB_VERSION) return NULL;
+    if (XXH_readLE32(blob + 360) != XXH32(blob, 360, 0)) return NULL;
+
+    int kind = blob[5];
+    uint64_t seed = XXH_readLE64(blob + 8);
+    uint32_t buffered = XXH_readLE32(blob + 32);
+    uint64_t stripes = XXH_readLE64(blob + 24);
+    if (kind != XXH_SESSION_XXH3_64 && kind != XXH_SESSION_XXH3_128) return NULL;
+    if (buffered > XXH3_INTERNALBUFFER_SIZE) return NULL;
+
+    // A fresh session with the same kind and seed rebuilds the secret
+    xxh_session* s = xxh_session_create(kind, (uint32_t)(seed & 0xFFFFFFFF), (uint32_t)(seed >> 32));
+    if (!s) return NULL;
+    XXH3_state_t* st = &s->state.s3;
+    if (stripes >= st->nbStripesPerBlock) {
+        xxh_session_free(s);
+        return NULL;
+    }
+
+    st->totalLen = XXH_readLE64(blob + 16);
+    st->nbStripesSoFar = (size_t)stripes;
+    st->bufferedSize = buffered;
+    for (int i = 0; i < 8; i++) {
+        st->acc[i] = XXH_readLE64(blob + 40 + i * 8);
+    }
+    memcpy(st->buffer, blob + 104, XXH3_INTERNALBUFFER_SIZE);
+    return s;
+}
+
+// Content-defined chunking (FastCDC)
+//
+// Cuts a stream into variable-size chunks whose boundaries depend only on
+// nearby content, so an insertion early in a file shifts one or two chunks
+// instead of all of them (dedup-friendly). Boundaries come from a gear
+// rolling hash (fp = (fp << 1) + gear[byte]) tested against FastCDC's
+// normalized masks: a stricter mask below avg_size and a looser one above
+// it, with nothing scanned before min_size and a forced cut at max_size.
+// The mask uses the top bits of fp, which depend on the last ~48+ bytes.
+//
+// Each chunk is hashed with XXH3-128 as it is cut, while its bytes are still
+// in cache, so the input is only streamed from memory once. Chunks that
+// span update calls are hashed through a session. The gear table is fixed
+// (splitmix64 from a constant seed): boundaries are part of the dedup
+// format and must not change between builds.
+
+typedef struct {
+    uint32_t min_size;
+    uint32_t avg_size;
+    uint32_t max_size;
+    uint64_t mask_s;     // below avg_size: harder to match
+    uint64_t mask_l;     // above avg_size: easier to match
+    uint64_t fp;         // gear hash of the current chunk
+    uint32_t pos;        // bytes of the current chunk seen so far
+    xxh_session* session;  // current chunk's hash when it spans calls
+    uint32_t* chunks;    // 5 words per chunk: [length, low0, high0, low1, high1]
+    int chunk_count;
+    int chunk_capacity;
+} xxh_cdc;
+
+#define XXH_CDC_WORDS 5
+
+// Gear table: 256 splitmix64 outputs seeded from 0x6A09E667F3BCC909. It is
+// a constant rather than built on first use, so cdc handles created from
+// pthreads workers cannot race on it
+static const uint64_t g_gear[256] = {
+    0x63CFC62A2B097592ULL, 0xDC0746B419466AECULL, 0x08264674F98AA19EULL, 0x3CA4EB47B26DE7ACULL,
+    0xA5B384AD339CFCC3ULL, 0x08F720D059892BC4ULL, 0xFE6675C92D60F3DFULL, 0x1D59C7B9C3A56969ULL,
+    0xEA5685B6014A22C9ULL, 0x3935C47EC47E016DULL, 0xF72314EF3D87AE57ULL, 0xE2C2311BA18CFD93ULL,
+    0x509D7011D7BC72C9ULL, 0x4CD89B9538C27512ULL, 0xA4E38806108A16A3ULL, 0x5A469FB3420A4216ULL,
+    0x5087CFEA06CFAE9EULL, 0x76EFEB82D49FAD30ULL, 0xA21F990415830CDDULL, 0xD3CF31C5DD26C237ULL,
+    0xB956E4E473A0297FULL, 0xE297A7E448A0894CULL, 0x779DA6821D493912ULL, 0xD71574055724395DULL,
+    0x797E22F607982BAEULL, 0xFEC040B03A7F1E41ULL, 0x1F258FAD67F64E49ULL, 0x4EDCDDD434469277ULL,
+    0xA2053EBD77CB8B08ULL, 0x77BF226305265856ULL, 0x6DE7291EAAA3D085ULL, 0x96D7536EA745DFFEULL,
+    0xF9C6680E94247B49ULL, 0xC88219FC9CF0493EULL, 0x1E31F2C96F41C928ULL, 0x6CFA87EDE9C1F270ULL,
+    0xA86D434537F8A23AULL, 0xA15F376D2BEF48D9ULL, 0x056617E9F8F42D36ULL, 0xF24B9093554CD786ULL,
+    0x62D56DAFE2BB1E59ULL, 0xB06DE4502F883955ULL, 0xBE4C8D8146C0D0ABULL, 0x83E66C7205D6AF78ULL,
+    0x78005FA8D605DED0ULL, 0x4B211F6233E98863ULL, 0x10451D9D286AB638ULL, 0x5BBD90AEA8B4B277ULL,
+    0x7F7AAEEA56D1839AULL, 0x65D4894ED4243013ULL, 0x6DD3AA78170E9AF1ULL, 0xD46A9444D3799968ULL,
+    0x659A245A5B481F0DULL, 0x15652888D3BBC8DFULL, 0x8B73FDDBCE64BEFAULL, 0x0BFCA26E4C5FB77AULL,
+    0xC4849A2EAE8581B2ULL, 0xC22DD397E260CD58ULL, 0x92F0919F78F49D90ULL, 0xECDD8449D5E796DFULL,
+    0x7A094A53DA9A2011ULL, 0x64FF8E701AC6665EULL, 0x9A2718AC8690427AULL, 0x03FEA5F1FFC6CDE0ULL,
+    0x19B6560A01AD4034ULL, 0x896A2EE68EDB277AULL, 0x6E8E7574571E76E7ULL, 0x4F248C2C5923DFB3ULL,
+    0xC6A7195479D02D29ULL, 0xB78C342F689ED1CDULL, 0x3FA86FBC793BCD5CULL, 0xC47C1E8411E1296DULL,
+    0x5F461BDE38862E3CULL, 0x15AA1C31A6D3E5D1ULL, 0xB59FFEAC43EB9BCFULL, 0xB33797B80682FB8EULL,
+    0x824247E1303DF497ULL, 0xBDA0B7E1A9BD1089ULL, 0xA3158AB71D99CD18ULL, 0xC25741ECD2AC9FB2ULL,
+    0x7173B3D306F6481FULL, 0x5FF080F221B0EC33ULL, 0xB80D9936EF1A2177ULL, 0x5BCF5EE0AFED6941ULL,
+    0x3367CDFC6E91746FULL, 0x628F06DC67CD8D10ULL, 0x9B5D29D3387D8FE0ULL, 0x411333C0F55727A3ULL,
+    0xE4F21DEF307BD64AULL, 0x654F7E53D53EC6A0ULL, 0x6D1C6352B72B2DC1ULL, 0xAB6B2E6636AB6A4BULL,
+    0xB8AC5A495D67C6BAULL, 0x508634631E16ACB4ULL, 0xA85BAF8D6401DFC2ULL, 0x56543E941681858EULL,
+    0x13B0BDF6C6AA8016ULL, 0x872FE81D3100D87EULL, 0x8540D20D3F17E625ULL, 0x54BF3B9582EC1C16ULL,
+    0xC88CE6672E8B2E5EULL, 0x77623F12632777F7ULL, 0x7ACF9CB3D918C7A5ULL, 0xFC7B344706E019A4ULL,
+    0xFE4CCCC591E759E7ULL, 0xC7C8AC08A93F8AB0ULL, 0x64E30E0B06F59CF4ULL, 0xD92EE107E60C68AFULL,
+    0x3A61F14615ED3141ULL, 0x8526D39F4B866B62ULL, 0x2EEC4B67D469BAEEULL, 0x85155E4BB6DB5F31ULL,
+    0x021329556FD9A48BULL, 0xAE2F1F8A0C98408DULL, 0x5C4ABDFDD6B64E09ULL, 0x927021ED7998449EULL,
+    0x50893FAC7A7016FDULL, 0x3BA5528718467B16ULL, 0x100E72354F14964FULL, 0x1E951030B91504E8ULL,
+    0x58BD6F3415956770ULL, 0x4C48F3DB2BB9FC97ULL, 0xC28DED4D7336172CULL, 0xC1C4F6479A92FBA1ULL,
+    0xEDD250179DC037B8ULL, 0xA0E9B4476994FE0AULL, 0x219722EAA7E134FAULL, 0x556A34C86B93E559ULL,
+    0x9F92CAD840DB5CD4ULL, 0xFA395BC0E72302D7ULL, 0xA93864EFA11688F6ULL, 0x4828B480A7404C16ULL,
+    0x009D7B1019146442ULL, 0x2AEA80DD0FD9A87EULL, 0xD2389AE17F520E2DULL, 0xCC8B4DC87A435309ULL,
+    0x545B2712728E32AEULL, 0x01972B2B759F6CA1ULL, 0x9AF4A0E7048E6CE3ULL, 0xCB79E95893453221ULL,
+    0xA667C7C7AC044B01ULL, 0xC5B96C9E221FFB06ULL, 0x3347CA5333568EC8ULL, 0x3D4E56D21AA59484ULL,
+    0xEAE72282CADAE561ULL, 0x4AB590A506746228ULL, 0xD5B666F6221B2E21ULL, 0xBC6EB34E99CBE624ULL,
+    0x3F5C97563F222382ULL, 0x11818C6E8CD33AEBULL, 0x709257E52D91C95BULL, 0x7AF8167DD67DA46BULL,
+    0x6B784107B9444E6AULL, 0xE503978988BE7F04ULL, 0xE6C096A8C4E5CB52ULL, 0x2E810F6DE7372820ULL,
+    0x08815BB43E764D8EULL, 0x74C020985B407417ULL, 0x9E5BB9D41235AC0CULL, 0x69D10C8E2DD755EFULL,
+    0x206BEEEE05BE9F92ULL, 0xED28A35C26976580ULL, 0x23FB223998C1DD8DULL, 0xE724F92BD60BEFA0ULL,
+    0x39F910450CE8735EULL, 0x96865BFFB2B5C9BBULL, 0xD9D8F838BF600228ULL, 0xC900366AAFB48B29ULL,
+    0xD9D5EC560DC809A8ULL, 0xD7D0A6827A0D88A4ULL, 0x5E5EE11DA7782ADCULL, 0x741096F1A8FD732BULL,
+    0x13F3ECA12FF5064AULL, 0x974B8DBA65A93A66ULL, 0x4EA1351F023DB3C3ULL, 0xDA1B38B862AE579BULL,
+    0x8AE3429F4A0FAB9EULL, 0x4CD0B9F748AEBC23ULL, 0xACB41C40A75220C2ULL, 0xECF3D4F5495040B0ULL,
+    0xC098556AA4CEA858ULL, 0x0776C8D915FC64FCULL, 0xAAF8BA2CDC7A9D41ULL, 0x13262BB0FE9E7BC3ULL,
+    0xB2261D77FA704973ULL, 0xAC195C7FAEBEF934ULL, 0xE501763A9BB39601ULL, 0x27495D1DD1641751ULL,
+    0x119959C9D15CB02EULL, 0xD86940CEC51602BBULL, 0x262826B68C324853ULL, 0x1C7A1127E871E1FFULL,
+    0x20CA7B07137B11EFULL, 0xA70A5636B444CE19ULL, 0xD8D7F430FB61F097ULL, 0x15743FA96D05DE00ULL,
+    0xA4FAF5C42789E8C0ULL, 0x8FA54C35BA03F12BULL, 0xDBAF39094B328278ULL, 0xD7B44DAE08633716ULL,
+    0xBE8ACC13573EAF72ULL, 0x415676D069C54CDBULL, 0xE24B949BE6A04823ULL, 0x2C8A22E1DD3ED3E1ULL,
+    0x4C27144D40FB62B7ULL, 0x463E6279A7B81991ULL, 0x604D1ED41AAD75DBULL, 0xD0432163DE9CDDD6ULL,
+    0xF5C2027B8CD976EEULL, 0xB9392320BF1C7771ULL, 0x46F091970B73C999ULL, 0x9FB9BB13EAE132ACULL,
+    0xE21E99F5A7DBE246ULL, 0xE5D30862BD54399CULL, 0x868E564B7F8E08E6ULL, 0x11CE898C645AFF49ULL,
+    0xE2F49C19A0015B61ULL, 0xF8F99E931A8DE3DEULL, 0x1BDAF88119FD69B7ULL, 0xCE8783E601C55607ULL,
+    0x16CC703CFEF765E0ULL, 0xEF4E3F641578FEECULL, 0x37B9075045450C0CULL, 0x34CC299AC8DC1C30ULL,
+    0xA6B0D3B0C86CEDDCULL, 0xD71694FA3D5E1565ULL, 0x077055995940B148ULL, 0x59B2DA7E56C8D627ULL,
+    0x59FF2A088D38836AULL, 0x04995A8AB2BF0E6DULL, 0x4B47C98BEE2B3EE3ULL, 0xE57A675401DCF414ULL,
+    0xADD6D14802BFADE9ULL, 0x8BECA4E9079B9384ULL, 0xA596917BEF1F1165ULL, 0xA2A0528C085AF450ULL,
+    0x2B91C70B62EC602BULL, 0xBA603814703EE279ULL, 0x04B0F614F48B56EAULL, 0xC6602758585ED9A0ULL,
+    0x4CCDFDDFAD39B91AULL, 0xD15FAC46DC6FFB91ULL, 0x1CF68851DB928B8FULL, 0x0521513088FCF276ULL,
+    0x134D10C63384C0E3ULL, 0xFD2F46B5CA56299AULL, 0xEA1D7278D225D8B0ULL, 0x22DCE3E8A727540EULL,
+    0x96F4940D70988C5AULL, 0x340A406CCD5405A0ULL, 0x14353BD6E3E5914BULL, 0x5320667655509344ULL,
+    0x2D878ACF43DEC8E0ULL, 0x0D0ADCD473AFC709ULL, 0x7B84EEFAA0E98D96ULL, 0xCED34DD05B9A775AULL,
+};
+
+static uint64_t xxh_cdc_mask(int bits) {
+    return ((1ULL << bits) - 1) << (64 - bits);
+}
+
+static void xxh_cdc_emit(xxh_cdc* c, uint32_t length, XXH128_hash_t hash) {
+    uint32_t* rec = c->chunks + c->chunk_count * XXH_CDC_WORDS;
+    rec[0] = length;
+    xxh_store128(rec + 1, hash);
+    c->chunk_count++;
+}
+
+/**
+ * Scan n bytes for the next cut point. Returns bytes consumed; *cut is set
+ * when the chunk ends after the last consumed byte.
+ */
+static size_t xxh_cdc_scan(xxh_cdc* c, const uint8_t* p, size_t n, int* cut) {
+    size_t base = c->pos;
+    size_t i = 0;
+    uint64_t fp = c->fp;
+    *cut = 0;
+
+    // Nothing before min_size can be a cut point, so those bytes are skipped
+    if (base < c->min_size) {
+        i = c->min_size - base;
+        if (i >= n) {
+            c->pos = (uint32_t)(base + n);
+            return n;
+        }
+    }
+
+    size_t limit = c->avg_size > base ? c->avg_size - base : 0;
+    if (limit > n) limit = n;
+    for (; i < limit; i++) {
+        fp = (fp << 1) + g_gear[p[i]];
+        if (!(fp & c->mask_s)) goto found;
+    }
+    limit = c->max_size - base;
+    if (limit > n) limit = n;
+    for (; i < limit; i++) {
+        fp = (fp << 1) + g_gear[p[i]];
+        if (!(fp & c->mask_l)) goto found;
+    }
+    if (base + i == c->max_size) {
+        *cut = 1;
+        return i;
+    }
+    c->fp = fp;
+    c->pos = (uint32_t)(base + n);
+    return n;
+
+found:
+    *cut = 1;
+    return i + 1;
+}
+
+static int xxh_cdc_reserve(xxh_cdc* c, int extra) {
+    if (c->chunk_count + extra <= c->chunk_capacity) return 1;
+    int capacity = c->chunk_capacity ? c->chunk_capacity : 64;
+    while (capacity < c->chunk_count + extra) capacity *= 2;
+    uint32_t* chunks = (uint32_t*)realloc(c->chunks, (size_t)capacity * XXH_CDC_WORDS * sizeof(uint32_t));
+    if (!chunks) return 0;
+    c->chunks = chunks;
+    c->chunk_capacity = capacity;
     return 1;
 }
 
+/**
+ * Create a chunker
+ * @param min_size Smallest chunk (e.g. 2KB); also the minimum skip
+ * @param avg_size Target average chunk (e.g. 8KB), rounded down to a power of two
+ * @param max_size Largest chunk (e.g. 64KB)
+ * Returns handle, or NULL unless 64 <= min_size <= avg_size <= max_size
+ */
+EMSCRIPTEN_KEEPALIVE
+xxh_cdc* xxh_cdc_create(uint32_t min_size, uint32_t avg_size, uint32_t max_size) {
+    if (min_size < 64 || min_size > avg_size || avg_size > max_size) return NULL;
+
+    xxh_cdc* c = (xxh_cdc*)calloc(1, sizeof(xxh_cdc));
+    if (!c) return NULL;
+    c->session = xxh_session_create(XXH_SESSION_XXH3_128, 0, 0);
+    if (!c->session) {
+        free(c);
+        return NULL;
+    }
+
+    int bits = 0;
+    while ((2U << bits) <= avg_size) bits++;
+    c->min_size = min_size;
+    c->avg_size = avg_size;
+    c->max_size = max_size;
+    // Normalization level 2 (FastCDC paper): +-2 bits around log2(avg_size)
+    c->mask_s = xxh_cdc_mask(bits + 2);
+    c->mask_l = xxh_cdc_mask(bits > 2 ? bits - 2 : 1);
+    return c;
+}
+
+/**
+ * Feed the next part of the stream. Chunks completed by this call replace
+ * the previous call's list (see xxh_cdc_chunks); bytes after the last cut
+ * carry over to the next call.
+ * Returns number of chunks completed, -3 on allocation failure
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh_cdc_update(xxh_cdc* c, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    c->chunk_count = 0;
+    if (!xxh_cdc_reserve(c, (int)(len / c->min_size) + 1)) return -3;
+
+    while (len > 0) {
+        size_t base = c->pos;
+        int cut;
+        size_t n = xxh_cdc_scan(c, p, len, &cut);
+        if (cut) {
+            XXH128_hash_t hash;
+            if (base == 0) {
+                // Whole chunk is in this buffer: one-shot hash
+                hash = xxh3_128_oneshot(p, n);
+            } else {
+                xxh_session_update(c->session, p, n);
+                hash = XXH3_128bits_digest(&c->session->state.s3);
+                xxh_session_reset(c->session);
+            }
+            xxh_cdc_emit(c, (uint32_t)(base + n), hash);
+            c->fp = 0;
+            c->pos = 0;
+        } else {
+            xxh_session_update(c->session, p, n);
+        }
+        p += n;
+        len -= n;
+    }
+    return c->chunk_count;
+}
+
+/**
+ * End of stream: emit the trailing partial chunk, if any, and reset the
+ * chunker for a new stream
+ * Returns number of chunks completed (0 or 1)
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh_cdc_final(xxh_cdc* c) {
+    c->chunk_count = 0;
+    if (c->pos > 0) {
+        xxh_cdc_emit(c, c->pos, XXH3_128bits_digest(&c->session->state.s3));
+        xxh_session_reset(c->session);
+        c->fp = 0;
+        c->pos = 0;
+    }
+    return c->chunk_count;
+}
+
+/**
+ * Chunks completed by the last update/final call, 5 words each:
+ * [length, low0, high0, low1, high1]
+ */
+EMSCRIPTEN_KEEPALIVE
+uint32_t* xxh_cdc_chunks(xxh_cdc* c) {
+    return c->chunks;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void xxh_cdc_free(xxh_cdc* c) {
+    if (!c) return;
+    xxh_session_free(c->session);
+    free(c->chunks);
+    free(c);
+}
+
+// Single-session XXH3-64 streaming API (kept for existing callers; a second
+// init restarts the one session, so use xxh_session_* for concurrent hashes)
+
+static xxh_session* g_streaming_session = NULL;
+
+EMSCRIPTEN_KEEPALIVE
+int xxh3_streaming_init(void) {
+    if (g_streaming_session) {
+        xxh_session_free(g_streaming_session);
+    }
+    g_streaming_session = xxh_session_create(XXH_SESSION_XXH3_64, 0, 0);
+    return g_streaming_session != NULL;
+}
+
 EMSCRIPTEN_KEEPALIVE
 int xxh3_streaming_update(const void* data, size_t len) {
-    if (!g_streaming_state) return 0;
-    return XXH3_64bits_update(g_streaming_state, data, len) == XXH_OK;
+    if (!g_streaming_session) return 0;
+    return xxh_session_update(g_streaming_session, data, len);
+}
+
+/**
+ * Digest of the single streaming session into out ([low32, high32]);
+ * zeros if no session is active
+ */
+EMSCRIPTEN_KEEPALIVE
+void xxh3_streaming_digest_into(uint32_t* out) {
+    if (!g_streaming_session) {
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+    xxh_session_digest(g_streaming_session, out);
 }
 
 EMSCRIPTEN_KEEPALIVE
 uint32_t* xxh3_streaming_digest(void) {
-    if (!g_streaming_state) {
-        xxhash64_result[0] = 0;
-        xxhash64_result[1] = 0;
-        return xxhash64_result;
-    }
-    uint64_t hash = XXH3_64bits_digest(g_streaming_state);
-    xxhash64_result[0] = (uint32_t)(hash & 0xFFFFFFFF);
-    xxhash64_result[1] = (uint32_t)(hash >> 32);
+    xxh3_streaming_digest_into(xxhash64_result);
     return xxhash64_result;
 }
 
+/**
+ * Checkpoint the single streaming session (see xxh_session_export)
+ * Returns bytes written, -1 if no session is active
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh3_streaming_export(uint8_t* blob) {
+    if (!g_streaming_session) return -1;
+    return xxh_session_export(g_streaming_session, blob);
+}
+
+/**
+ * Replace the single streaming session with a checkpointed one
+ * Returns 1 on success, 0 if the blob is rejected (current session kept)
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxh3_streaming_import(const uint8_t* blob, size_t size) {
+    xxh_session* s = xxh_session_import(blob, size);
+    if (!s || s->kind != XXH_SESSION_XXH3_64) {
+        xxh_session_free(s);
+        return 0;
+    }
+    xxh_session_free(g_streaming_session);
+    g_streaming_session = s;
+    return 1;
+}
+
 EMSCRIPTEN_KEEPALIVE
 void xxh3_streaming_free(void) {
-    if (g_streaming_state) {
-        XXH3_freeState(g_streaming_state);
-        g_streaming_state = NULL;
+    if (g_streaming_session) {
+        xxh_session_free(g_streaming_session);
+        g_streaming_session = NULL;
     }
 }
 
+/**
+ * @return 1 if this is the simd128 build, 0 for the scalar build
+ */
+EMSCRIPTEN_KEEPALIVE
+int xxhash_simd(void) {
+#ifdef __wasm_simd128__
+    return 1;
+#else
+    return 0;
+#endif
+}
+
 /**
  * Get version
  */